@@ -0,0 +1,265 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            smartLED_bench.c
+ * \author          Andrea Vivani
+ * \brief           Host benchmark of the smartLED encode path
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Includes ------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "smartLED.h"
+
+/* Macros --------------------------------------------------------------------*/
+
+/* Timer auto-reload value used for the benchmark, as for 800 kHz on an 84 MHz timer clock */
+#define BENCH_TIMER_ARR   104u
+
+/* Minimum number of LEDs encoded for each configuration */
+#define BENCH_MIN_LEDS    200000u
+
+/* Private variables ---------------------------------------------------------*/
+
+SMARTLED_DEFINE_STATIC(bench_RGB8, WS2812B, SMARTLED_RGB, 600, 8);
+SMARTLED_DEFINE_STATIC(bench_RGB32, WS2812B, SMARTLED_RGB, 600, 32);
+SMARTLED_DEFINE_STATIC(bench_RGBW8, WS2812B, SMARTLED_RGBW, 600, 8);
+SMARTLED_DEFINE_STATIC(bench_RGBW32, WS2812B, SMARTLED_RGBW, 600, 32);
+
+/* Private Functions ---------------------------------------------------------*/
+
+static uint64_t bench_nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Send frames of random colors until BENCH_MIN_LEDS LEDs are encoded, and print the time spent */
+static void bench_frames(smartLED_t* strip) {
+    uint8_t* colors = malloc((size_t)strip->type * strip->size);
+    uint32_t frames, IRQs = 0;
+    uint64_t totalNs = 0, IRQNs = 0;
+
+    srand(strip->size);
+    for (uint32_t ii = 0; ii < (uint32_t)strip->type * strip->size; ii++) {
+        colors[ii] = (uint8_t)rand();
+    }
+    smartLED_blit(strip, 0, strip->size, colors, strip->colorOrder);
+    smartLED_setBrightness(strip, 200);
+    free(colors);
+
+    frames = (BENCH_MIN_LEDS + strip->size - 1u) / strip->size;
+    for (uint32_t ff = 0; ff < frames; ff++) {
+        smartLEDIRQType_t IRQ = SMARTLED_IRQ_HALFCPLT;
+        uint64_t frameStart = bench_nowNs();
+
+        smartLED_invalidate(strip);
+        smartLED_startTransfer(strip);
+        while (smartLED_isUpdating(strip)) {
+            uint64_t IRQStart = bench_nowNs();
+            smartLED_updateTransfer(strip, IRQ);
+            IRQNs += bench_nowNs() - IRQStart;
+            IRQs++;
+            IRQ = (IRQ == SMARTLED_IRQ_HALFCPLT) ? SMARTLED_IRQ_FINISHED : SMARTLED_IRQ_HALFCPLT;
+        }
+        totalNs += bench_nowNs() - frameStart;
+    }
+
+    printf("%-5s %6u %9u %8u %10.2f %10.1f %10.1f\n", (strip->type == SMARTLED_RGB) ? "RGB" : "RGBW", strip->size, strip->LEDperIRQ, IRQs / frames,
+           (double)totalNs / ((double)frames * strip->size), (double)IRQNs / IRQs, (double)totalNs / (frames * 1000.0));
+
+#ifdef SMARTLED_USE_STATS
+    smartLEDStats_t stats;
+
+    smartLED_getStats(strip, &stats);
+    printf("      driver stats: IRQ min/avg/max %u/%u/%u cycles, last frame %u cycles, %u frames, %u late refills\n", stats.IRQCyclesMin,
+           stats.IRQCyclesAvg, stats.IRQCyclesMax, stats.frameCycles, stats.framesCompleted, stats.lateRefills);
+#endif /* SMARTLED_USE_STATS */
+}
+
+static int bench_run(smartLEDType_t type, uint16_t size, uint8_t LEDperIRQ) {
+    TIM_TypeDef timRegs = {.ARR = BENCH_TIMER_ARR};
+    TIM_HandleTypeDef htim = {.Instance = &timRegs};
+    smartLED_t strip = {0};
+    uint8_t *data, *DMABuffer;
+
+    strip.chip = WS2812B;
+    strip.type = type;
+    strip.size = size;
+    strip.htim = &htim;
+    strip.timType = SMARTLED_TIMER_NORMAL;
+    strip.timChannel = TIM_CHANNEL_1;
+    strip.LEDperIRQ = LEDperIRQ;
+
+    data = calloc(SMARTLED_DATA_SIZE(type, size, SMARTLED_PALETTE_NONE), sizeof(uint8_t));
+    DMABuffer = calloc(SMARTLED_DMA_SIZE(type, LEDperIRQ), sizeof(uint8_t));
+    if ((data == NULL) || (DMABuffer == NULL) || (smartLED_initStatic(&strip, data, DMABuffer) != SMARTLED_SUCCESS)) {
+        free(data);
+        free(DMABuffer);
+        return -1;
+    }
+    bench_frames(&strip);
+
+    free(data);
+    free(DMABuffer);
+    return 0;
+}
+
+/* Same frames on strips defined by SMARTLED_DEFINE_STATIC, refilled by their specialized encoder */
+static int bench_static(void) {
+    static TIM_TypeDef timRegs = {.ARR = BENCH_TIMER_ARR};
+    static TIM_HandleTypeDef htim = {.Instance = &timRegs};
+    smartLED_t* strips[] = {&bench_RGB8, &bench_RGB32, &bench_RGBW8, &bench_RGBW32};
+    smartLED_retStatus_t (*const inits[])(void) = {bench_RGB8_init, bench_RGB32_init, bench_RGBW8_init, bench_RGBW32_init};
+
+    for (size_t ss = 0; ss < sizeof(strips) / sizeof(strips[0]); ss++) {
+        strips[ss]->htim = &htim;
+        strips[ss]->timType = SMARTLED_TIMER_NORMAL;
+        strips[ss]->timChannel = TIM_CHANNEL_1;
+        if (inits[ss]() != SMARTLED_SUCCESS) {
+            return -1;
+        }
+        bench_frames(strips[ss]);
+    }
+    return 0;
+}
+
+/* Host time per LED of the bulk color functions, against the per-LED setter */
+static int bench_bulk(smartLEDType_t type, uint16_t size) {
+    TIM_TypeDef timRegs = {.ARR = BENCH_TIMER_ARR};
+    TIM_HandleTypeDef htim = {.Instance = &timRegs};
+    smartLED_t strip = {0};
+    uint8_t *source, *HSV;
+    uint64_t start, setNs, fillNs, blitNs, HSVNs;
+    uint32_t rounds = (BENCH_MIN_LEDS + size - 1u) / size;
+
+    strip.chip = WS2812B;
+    strip.type = type;
+    strip.size = size;
+    strip.htim = &htim;
+    strip.timType = SMARTLED_TIMER_NORMAL;
+    strip.timChannel = TIM_CHANNEL_1;
+    strip.LEDperIRQ = 8;
+    source = malloc((size_t)type * size);
+    HSV = malloc(3u * size);
+    if ((source == NULL) || (HSV == NULL) || (smartLED_init(&strip) != SMARTLED_SUCCESS)) {
+        free(source);
+        free(HSV);
+        return -1;
+    }
+    for (uint32_t ii = 0; ii < (uint32_t)type * size; ii++) {
+        source[ii] = (uint8_t)rand();
+    }
+    for (uint32_t ii = 0; ii < 3u * size; ii++) {
+        HSV[ii] = (uint8_t)rand();
+    }
+
+    start = bench_nowNs();
+    for (uint32_t rr = 0; rr < rounds; rr++) {
+        for (uint16_t ii = 0; ii < size; ii++) {
+            smartLED_updateRGBColors(&strip, ii, rr, ii, 0x55);
+        }
+    }
+    setNs = bench_nowNs() - start;
+
+    start = bench_nowNs();
+    for (uint32_t rr = 0; rr < rounds; rr++) {
+        smartLED_fillRGBRange(&strip, 0, size, (uint8_t)rr, 0xAA, 0x55);
+    }
+    fillNs = bench_nowNs() - start;
+
+    start = bench_nowNs();
+    for (uint32_t rr = 0; rr < rounds; rr++) {
+        smartLED_blit(&strip, 0, size, source, (rr & 1u) ? SMARTLED_ORDER_RGB : strip.colorOrder);
+    }
+    blitNs = bench_nowNs() - start;
+
+    start = bench_nowNs();
+    for (uint32_t rr = 0; rr < rounds; rr++) {
+        smartLED_blitHSV(&strip, 0, size, HSV);
+    }
+    HSVNs = bench_nowNs() - start;
+
+    printf("%-5s %6u %10.2f %10.2f %10.2f %10.2f\n", (type == SMARTLED_RGB) ? "RGB" : "RGBW", size, (double)setNs / ((double)rounds * size),
+           (double)fillNs / ((double)rounds * size), (double)blitNs / ((double)rounds * size), (double)HSVNs / ((double)rounds * size));
+
+    free(source);
+    free(HSV);
+    return 0;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+int main(void) {
+    static const smartLEDType_t types[] = {SMARTLED_RGB, SMARTLED_RGBW};
+    static const uint16_t sizes[] = {30, 150, 600, 2000};
+    static const uint8_t LEDsPerIRQ[] = {1, 4, 8, 16, 32};
+
+#ifdef SMARTLED_USE_LUT
+    printf("encoder: lookup table\n");
+#else
+    printf("encoder: bitwise\n");
+#endif /* SMARTLED_USE_LUT */
+#if defined(SMARTLED_USE_GAMMA) && defined(SMARTLED_USE_DITHERING)
+    printf("colors: gamma corrected and dithered\n");
+#elif defined(SMARTLED_USE_GAMMA)
+    printf("colors: gamma corrected\n");
+#elif defined(SMARTLED_USE_DITHERING)
+    printf("colors: dithered\n");
+#endif
+    printf("%-5s %6s %9s %8s %10s %10s %10s\n", "type", "size", "LEDperIRQ", "IRQs", "ns/LED", "ns/IRQ", "us/frame");
+
+    for (size_t tt = 0; tt < sizeof(types) / sizeof(types[0]); tt++) {
+        for (size_t ss = 0; ss < sizeof(sizes) / sizeof(sizes[0]); ss++) {
+            for (size_t ll = 0; ll < sizeof(LEDsPerIRQ) / sizeof(LEDsPerIRQ[0]); ll++) {
+                if (bench_run(types[tt], sizes[ss], LEDsPerIRQ[ll]) != 0) {
+                    printf("%-5s %6u %9u configuration failed\n", (types[tt] == SMARTLED_RGB) ? "RGB" : "RGBW", sizes[ss], LEDsPerIRQ[ll]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("\nstatic definitions, specialized encoder\n");
+    if (bench_static() != 0) {
+        printf("static configuration failed\n");
+        return 1;
+    }
+
+    printf("\n%-5s %6s %10s %10s %10s %10s\n", "type", "size", "set ns/LED", "fill", "blit", "HSV");
+    for (size_t tt = 0; tt < sizeof(types) / sizeof(types[0]); tt++) {
+        if (bench_bulk(types[tt], 2000) != 0) {
+            printf("%-5s bulk configuration failed\n", (types[tt] == SMARTLED_RGB) ? "RGB" : "RGBW");
+            return 1;
+        }
+    }
+    return 0;
+}
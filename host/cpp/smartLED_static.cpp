@@ -0,0 +1,115 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            smartLED_static.cpp
+ * \author          Andrea Vivani
+ * \brief           Host build check of the smartLEDStatic C++ template
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "smartLED.h"
+
+/* Macros --------------------------------------------------------------------*/
+
+/* Timer auto-reload value, as for 800 kHz on an 84 MHz timer clock */
+#define STATIC_TIMER_ARR 104u
+
+/* Private Functions ---------------------------------------------------------*/
+
+/* Send one frame on the template strip and on a strip with the generic encoder, with the same colors, and compare every refill */
+template <smartLEDType_t Type, uint16_t Size, uint8_t LEDperIRQ>
+static int static_check(const char* name) {
+    static smartLEDStatic<WS2812B, Type, Size, LEDperIRQ> templ;
+    std::vector<uint8_t> data(smartLEDStatic<WS2812B, Type, Size, LEDperIRQ>::dataSize), DMA(smartLEDStatic<WS2812B, Type, Size, LEDperIRQ>::DMASize);
+    TIM_TypeDef timRegs[2] = {};
+    TIM_HandleTypeDef htim[2] = {};
+    smartLED_t generic = {};
+    smartLED_t* strips[2] = {&templ.strip, &generic};
+    uint32_t refills = 0, mismatches = 0;
+
+    generic.chip = WS2812B;
+    generic.type = Type;
+    generic.size = Size;
+    generic.LEDperIRQ = LEDperIRQ;
+    for (uint8_t ss = 0; ss < 2u; ss++) {
+        timRegs[ss].ARR = STATIC_TIMER_ARR;
+        htim[ss].Instance = &timRegs[ss];
+        strips[ss]->htim = &htim[ss];
+        strips[ss]->timType = SMARTLED_TIMER_NORMAL;
+        strips[ss]->timChannel = TIM_CHANNEL_1;
+    }
+    if ((templ.init() != SMARTLED_SUCCESS) || (templ.strip._encodeBlock == NULL)
+        || (smartLED_initStatic(&generic, data.data(), DMA.data()) != SMARTLED_SUCCESS)) {
+        std::printf("%s: init failed\n", name);
+        return 1;
+    }
+
+    for (uint16_t ii = 0; ii < Size; ii++) {
+        for (uint8_t cc = 0; cc < Type; cc++) {
+            uint8_t value = (uint8_t)(ii * 37u + cc * 101u);
+
+            for (uint8_t ss = 0; ss < 2u; ss++) {
+                smartLED_updateColor(strips[ss], ii, (smartLEDColor_t)cc, value);
+            }
+        }
+    }
+    for (uint8_t ss = 0; ss < 2u; ss++) {
+        smartLED_setBrightness(strips[ss], 200);
+        smartLED_startTransfer(strips[ss]);
+    }
+
+    /* Both strips are refilled in lockstep, half buffer by half buffer */
+    while (smartLED_isUpdating(&templ.strip) && smartLED_isUpdating(&generic)) {
+        smartLEDIRQType_t IRQ = (refills & 1u) ? SMARTLED_IRQ_FINISHED : SMARTLED_IRQ_HALFCPLT;
+
+        for (uint8_t ss = 0; ss < 2u; ss++) {
+            smartLED_updateTransfer(strips[ss], IRQ);
+        }
+        if (std::memcmp(templ.strip._dmaBuffer, generic._dmaBuffer, smartLEDStatic<WS2812B, Type, Size, LEDperIRQ>::DMASize) != 0) {
+            mismatches++;
+        }
+        refills++;
+    }
+    std::printf("%s: %u refills, %u differ from the generic encoder\n", name, refills, mismatches);
+    return (mismatches || smartLED_isUpdating(&templ.strip) || smartLED_isUpdating(&generic)) ? 1 : 0;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+int main() {
+    int ret = 0;
+
+    ret |= static_check<SMARTLED_RGB, 600, 8>("RGB, 600 LEDs, 8 per IRQ");
+    ret |= static_check<SMARTLED_RGB, 61, 32>("RGB, 61 LEDs, 32 per IRQ");
+    ret |= static_check<SMARTLED_RGBW, 300, 5>("RGBW, 300 LEDs, 5 per IRQ");
+    return ret;
+}
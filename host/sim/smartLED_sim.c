@@ -0,0 +1,1372 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            smartLED_sim.c
+ * \author          Andrea Vivani
+ * \brief           Host simulator of the circular PWM, parallel PWM or SPI DMA transfer
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "smartLED.h"
+#include "smartLED_adalight.h"
+
+/* Macros --------------------------------------------------------------------*/
+
+/* Duration of one PWM period (one WS281x bit) in ns */
+#define SIM_BIT_NS       (1000000.0 / SMARTLED_PWM_FREQ)
+
+/* Maximum number of DMA elements simulated before giving up */
+#define SIM_MAX_ELEMENTS 100000000u
+
+/* Maximum number of events printed in detail */
+#define SIM_MAX_REPORTED 10u
+
+/* With SMARTLED_USE_TIMED_RESET, circular DMA stops before the end of the reset, the line being left low and the next start failing
+ * until the rest of it has elapsed */
+#ifdef SMARTLED_USE_TIMED_RESET
+#define SIM_TIMED_RESET 1
+#else
+#define SIM_TIMED_RESET 0
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+/* Typedefs ------------------------------------------------------------------*/
+
+/**
+ * Symbol seen on the line during one WS281x bit
+ */
+typedef enum {
+    SIM_SYMBOL_IDLE = 0,
+    SIM_SYMBOL_ZERO = 1,
+    SIM_SYMBOL_ONE = 2,
+    SIM_SYMBOL_INVALID = 3,
+} simSymbol_t;
+
+/**
+ * Simulation parameters
+ */
+typedef struct {
+    smartLEDChip_t chip;
+    smartLEDType_t type;
+    uint16_t size;
+    uint8_t LEDperIRQ;
+    uint8_t brightness;
+    uint32_t ARR;
+    double encodeNs;      // cost of encoding one LED in the IRQ
+    double IRQNs;         // fixed cost of each IRQ (entry, exit and bookkeeping)
+    unsigned seed;
+    uint16_t refreshRate; // streaming refresh rate, 0 for the highest one
+    uint8_t streaming;    // 1 to use smartLED_startStreaming()
+    uint32_t frames;      // number of streaming frames
+    uint8_t lanes;        // number of parallel lanes, 0 for a single strip
+    uint8_t shader;       // 1 to render colors with a pixel shader instead of the LED data array
+    smartLEDPalette_t palette;
+    smartLEDColorOrder_t colorOrder;
+    smartLEDDMAMode_t dmaMode;
+    uint32_t updates;     // number of partial updates sent after the first frame
+    uint16_t fade;        // length of the crossfade to a second set of colors in frames, 0 for none
+    uint8_t staticDef;    // 1 to use a strip defined by SMARTLED_DEFINE_STATIC
+    uint8_t group;        // number of strips on separate timers started as a strip group, 0 for none
+    uint8_t autoTune;     // 1 to choose LEDperIRQ with smartLED_initAutoTune()
+    uint16_t marginUs;    // IRQ latency the tuned LEDperIRQ must tolerate
+    uint32_t RAMBudget;   // maximum DMA buffer size of the tuned LEDperIRQ
+    uint16_t adalight;    // largest chunk of Adalight stream passed to the parser, 0 to set colors directly
+    uint8_t doubleBuffer; // 1 to alternate smartLED_present() of the back buffer and smartLED_startTransfer() of the front one
+#ifdef SMARTLED_USE_SPI
+    smartLEDOutput_t output;
+#endif /* SMARTLED_USE_SPI */
+} simParams_t;
+
+/**
+ * Decoder of the line as seen by the first chip
+ */
+typedef struct {
+    uint8_t* expected;       // bytes each frame should contain
+    void (*expect)(uint8_t* expected, uint32_t frame); // if set, updates expected before each frame is checked
+    uint32_t nExpected;
+    uint8_t* bytes;          // decoded bytes of the current frame
+    uint32_t nBytes;         // number of complete bytes decoded in the current frame
+    uint8_t current;         // byte being decoded
+    uint8_t nBits;           // bits of the current byte
+    uint64_t resetBits;      // idle periods that latch a frame
+    uint64_t idleRun;        // current number of consecutive idle periods
+    uint64_t minGap;         // shortest idle run that latched a frame
+    uint8_t started;         // 1 after the first data bit
+    double frameStart;       // time of the first bit of the current frame
+    double firstFrameStart;  // time of the first bit of the first frame
+    uint32_t frames;         // decoded frames
+    uint32_t badFrames;      // frames that differ from expected
+    uint32_t invalid;        // symbols that are neither a 0, a 1 nor idle
+    uint32_t gaps;           // idle periods shorter than the reset time between two data bits
+} simDecoder_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static uint32_t sim_framesStarted, sim_framesRequested;
+static simParams_t sim_params;
+
+/* Strips defined at compile time for -z, with the default size and LEDperIRQ */
+#define SIM_STATIC_SIZE      600
+#define SIM_STATIC_LEDPERIRQ 8
+SMARTLED_DEFINE_STATIC(sim_staticRGB, WS2812B, SMARTLED_RGB, SIM_STATIC_SIZE, SIM_STATIC_LEDPERIRQ);
+SMARTLED_DEFINE_STATIC(sim_staticRGBW, WS2812B, SMARTLED_RGBW, SIM_STATIC_SIZE, SIM_STATIC_LEDPERIRQ);
+
+/* Color orders accepted by -k, in smartLEDColorOrder_t order, and the wire position of red, green and blue */
+static const char* const sim_orderNames[6] = {"grb", "rgb", "brg", "rbg", "gbr", "bgr"};
+static const uint8_t sim_orderOffsets[6][3] = {{1, 0, 2}, {0, 1, 2}, {1, 2, 0}, {0, 2, 1}, {2, 0, 1}, {2, 1, 0}};
+
+#ifdef SMARTLED_USE_COLOR_TABLE
+/* Expected output of each color value in 8.8 fixed point, computed independently of the driver table */
+static uint16_t sim_colorTable[256];
+#endif /* SMARTLED_USE_COLOR_TABLE */
+
+/* Colors the crossfade starts from and ends to, and the blend of the frame being checked, in RGB(W) order */
+static uint8_t *sim_fadeFrom, *sim_fadeTo, *sim_blended;
+
+#ifdef SMARTLED_USE_DITHERING
+/* Colors, expected bytes and dithering error of each lane, to follow the error carried from frame to frame */
+static const smartLED_t* sim_strips;
+static uint8_t *sim_colors[SMARTLED_PARALLEL_MAX_LANES], *sim_expected[SMARTLED_PARALLEL_MAX_LANES], *sim_error[SMARTLED_PARALLEL_MAX_LANES];
+#endif /* SMARTLED_USE_DITHERING */
+
+/* Private Functions ---------------------------------------------------------*/
+
+static double sim_resetNs(smartLEDChip_t chip) { return (chip == WS2811) ? 280000.0 : 50000.0; }
+
+static void sim_frameEnd(simDecoder_t* dec) {
+    uint32_t mismatches = 0;
+
+    if (dec->expect != NULL) {
+        dec->expect(dec->expected, dec->frames);
+    }
+
+    for (uint32_t ii = 0; ii < dec->nExpected; ii++) {
+        if ((ii >= dec->nBytes) || (dec->bytes[ii] != dec->expected[ii])) {
+            if (!dec->badFrames && (mismatches < SIM_MAX_REPORTED)) {
+                printf("frame %u mismatch at byte %u: expected 0x%02X, got 0x%02X\n", dec->frames, ii, dec->expected[ii],
+                       (ii < dec->nBytes) ? dec->bytes[ii] : 0);
+            }
+            mismatches++;
+        }
+    }
+    if (mismatches || (dec->nBytes != dec->nExpected) || dec->nBits) {
+        if (!dec->badFrames) {
+            printf("frame %u: %u bytes and %u bits decoded, %u bytes expected, %u mismatches\n", dec->frames, dec->nBytes, dec->nBits,
+                   dec->nExpected, mismatches);
+        }
+        dec->badFrames++;
+    }
+    dec->frames++;
+    dec->nBytes = 0;
+    dec->nBits = 0;
+}
+
+static void sim_decode(simDecoder_t* dec, simSymbol_t symbol, double t) {
+    if (symbol == SIM_SYMBOL_IDLE) {
+        dec->idleRun++;
+        return;
+    }
+
+    if (!dec->started) {
+        dec->started = 1;
+        dec->frameStart = dec->firstFrameStart = t;
+    } else if (dec->idleRun >= dec->resetBits) {
+        /* Reset latched the previous frame */
+        sim_frameEnd(dec);
+        if (dec->idleRun < dec->minGap) {
+            dec->minGap = dec->idleRun;
+        }
+        dec->frameStart = t;
+    } else if (dec->idleRun) {
+        dec->gaps++;
+    }
+    dec->idleRun = 0;
+
+    if (symbol == SIM_SYMBOL_INVALID) {
+        dec->invalid++;
+    }
+    dec->current = (uint8_t)((dec->current << 1) | (symbol == SIM_SYMBOL_ONE));
+    if (++dec->nBits == 8) {
+        if (dec->nBytes < dec->nExpected) {
+            dec->bytes[dec->nBytes] = dec->current;
+        }
+        dec->nBytes++;
+        dec->nBits = 0;
+    }
+}
+
+/* One DMA element of the PWM output is one WS281x bit */
+static void sim_decodePWM(simDecoder_t* dec, const smartLED_t* strip, uint8_t value, double t) {
+    if (value == 0) {
+        sim_decode(dec, SIM_SYMBOL_IDLE, t);
+    } else if (value == strip->_pulseHigh) {
+        sim_decode(dec, SIM_SYMBOL_ONE, t);
+    } else if (value == strip->_pulseLow) {
+        sim_decode(dec, SIM_SYMBOL_ZERO, t);
+    } else {
+        sim_decode(dec, SIM_SYMBOL_INVALID, t);
+    }
+}
+
+#ifdef SMARTLED_USE_SPI
+/* One DMA element of the SPI output is 8 line bits, n of them make one WS281x bit */
+static void sim_decodeSPI(simDecoder_t* dec, uint8_t n, uint8_t value, double t) {
+    static uint32_t symbol, nSub;
+    const uint32_t one = (n == SMARTLED_OUTPUT_SPI_3BIT) ? 0x6u : 0xEu;
+    const uint32_t zero = (n == SMARTLED_OUTPUT_SPI_3BIT) ? 0x4u : 0x8u;
+
+    for (uint32_t ii = 0; ii < 8u; ii++) {
+        symbol = (symbol << 1) | ((value >> (7u - ii)) & 1u);
+        if (++nSub == n) {
+            double symbolStart = t + (ii + 1u - n) * SIM_BIT_NS / n;
+
+            if (symbol == 0) {
+                sim_decode(dec, SIM_SYMBOL_IDLE, symbolStart);
+            } else if (symbol == one) {
+                sim_decode(dec, SIM_SYMBOL_ONE, symbolStart);
+            } else if (symbol == zero) {
+                sim_decode(dec, SIM_SYMBOL_ZERO, symbolStart);
+            } else {
+                sim_decode(dec, SIM_SYMBOL_INVALID, symbolStart);
+            }
+            symbol = 0;
+            nSub = 0;
+        }
+    }
+}
+#endif /* SMARTLED_USE_SPI */
+
+/* Color value sent without dithering */
+static uint8_t sim_scale(uint8_t value) {
+#ifdef SMARTLED_USE_COLOR_TABLE
+    return (uint8_t)((sim_colorTable[value] + 0x80u) >> 8);
+#else
+    return (uint8_t)((value * sim_params.brightness) / 0xFF);
+#endif /* SMARTLED_USE_COLOR_TABLE */
+}
+
+/* Bytes the first chip receives for colors given in RGB(W) order */
+static void sim_expectLED(uint8_t* e, const uint8_t* rgbw) {
+    for (uint8_t ii = 0; ii < 3u; ii++) {
+        e[sim_orderOffsets[sim_params.colorOrder][ii]] = sim_scale(rgbw[ii]);
+    }
+    if (sim_params.type == SMARTLED_RGBW) {
+        e[3] = sim_scale(rgbw[3]);
+    }
+}
+
+#ifdef SMARTLED_USE_DITHERING
+/* Wire order byte stream of a dithered frame, each LED sending the integer part of its color plus the error of the previous frame */
+static void sim_ditherExpected(uint8_t* expected, uint32_t frame) {
+    uint8_t lane = 0;
+
+    (void)frame;
+    while (sim_expected[lane] != expected) {
+        lane++;
+    }
+    for (uint32_t ii = 0; ii < (uint32_t)sim_strips[lane].size * sim_params.type; ii += sim_params.type) {
+        for (uint8_t cc = 0; cc < sim_params.type; cc++) {
+            uint8_t wire = (cc < 3u) ? sim_orderOffsets[sim_params.colorOrder][cc] : 3u;
+            uint32_t value = (uint32_t)sim_colorTable[sim_colors[lane][ii + cc]] + sim_error[lane][ii + wire];
+
+            sim_error[lane][ii + wire] = (uint8_t)value;
+            expected[ii + wire] = (uint8_t)(value >> 8);
+        }
+    }
+}
+#endif /* SMARTLED_USE_DITHERING */
+
+/* Wire order byte stream of a crossfade frame, the first frame being the first step and the last one the target colors */
+static void sim_fadeExpected(uint8_t* expected, uint32_t frame) {
+    uint32_t blend = (frame + 1u < sim_params.fade) ? (((frame + 1u) << 8) / sim_params.fade) : 256u;
+
+    for (uint32_t ii = 0; ii < (uint32_t)sim_params.size * sim_params.type; ii++) {
+        sim_blended[ii] = (uint8_t)((sim_fadeFrom[ii] * (256u - blend) + sim_fadeTo[ii] * blend) >> 8);
+    }
+#ifdef SMARTLED_USE_DITHERING
+    sim_ditherExpected(expected, frame);
+#else
+    for (uint32_t ii = 0; ii < (uint32_t)sim_params.size * sim_params.type; ii += sim_params.type) {
+        sim_expectLED(&expected[ii], &sim_blended[ii]);
+    }
+#endif /* SMARTLED_USE_DITHERING */
+}
+
+static uint32_t sim_shader(uint16_t index, uint32_t frameCounter) {
+    uint32_t x = (index * 2654435761u) ^ (frameCounter * 40503u + sim_params.seed);
+
+    x ^= x >> 15;
+    x *= 0x2C1B3C6Du;
+    x ^= x >> 12;
+    return x;
+}
+
+/* Wire order byte stream produced by sim_shader() during frame */
+static void sim_shaderExpected(uint8_t* expected, uint32_t frame) {
+    for (uint16_t ii = 0; ii < sim_params.size; ii++) {
+        uint32_t value = sim_shader(ii, frame);
+        uint8_t rgbw[4] = {(uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value, (uint8_t)(value >> 24)};
+
+        sim_expectLED(&expected[ii * sim_params.type], rgbw);
+    }
+}
+
+static void sim_frameCallback(smartLED_t* smartled) {
+    if (++sim_framesStarted >= sim_framesRequested) {
+        smartLED_stopStreaming(smartled);
+    }
+}
+
+/* Change a random range of LEDs with the color functions in turn, only the LEDs up to its end are sent again */
+/* Adalight stream fed to the parser, with the position of the colors and the LED count of each frame */
+static uint8_t* sim_adaStream;
+static uint32_t sim_adaLength, sim_adaPos, sim_adaBadHeaders;
+static uint32_t *sim_adaData, *sim_adaLEDs;
+
+/* Adalight frames of size, half and more than size LEDs, each preceded by noise and every other by a header with a wrong checksum */
+static void sim_adalightStream(uint32_t frames) {
+    uint32_t maxLength = frames * (2u * 16u + 2u * 6u + 3u * (sim_params.size + 7u));
+
+    sim_adaStream = malloc(maxLength);
+    sim_adaData = malloc(frames * sizeof(uint32_t));
+    sim_adaLEDs = malloc(frames * sizeof(uint32_t));
+    sim_adaLength = 0;
+    for (uint32_t ff = 0; ff < frames; ff++) {
+        uint32_t LEDs = (ff % 3u == 0) ? sim_params.size : ((ff % 3u == 1u) ? sim_params.size / 2u + 1u : sim_params.size + 7u);
+        uint8_t hi = (uint8_t)((LEDs - 1u) >> 8), lo = (uint8_t)(LEDs - 1u);
+
+        for (uint8_t hh = 0; hh < ((ff & 1u) ? 2u : 1u); hh++) {
+            uint8_t bad = (ff & 1u) && (hh == 0);
+
+            /* Noise never starts a header */
+            for (uint32_t ii = rand() % 16u; ii; ii--) {
+                uint8_t noise = (uint8_t)rand();
+
+                sim_adaStream[sim_adaLength++] = (noise == 'A') ? 'B' : noise;
+            }
+            sim_adaStream[sim_adaLength++] = 'A';
+            sim_adaStream[sim_adaLength++] = 'd';
+            sim_adaStream[sim_adaLength++] = 'a';
+            sim_adaStream[sim_adaLength++] = hi;
+            sim_adaStream[sim_adaLength++] = lo;
+            sim_adaStream[sim_adaLength++] = (uint8_t)(hi ^ lo ^ 0x55u ^ (bad ? 0xFFu : 0x00u));
+            sim_adaBadHeaders += bad;
+        }
+        sim_adaData[ff] = sim_adaLength;
+        sim_adaLEDs[ff] = LEDs;
+        for (uint32_t ii = 0; ii < 3u * LEDs; ii++) {
+            sim_adaStream[sim_adaLength++] = (uint8_t)rand();
+        }
+    }
+}
+
+/* Feed random chunks of the stream until the parser starts the transfer of the given frame, bytes not consumed are passed again */
+static smartLED_retStatus_t sim_adalightFeed(smartLEDAdalight_t* ada, uint8_t* colors, uint8_t* expected, uint32_t frame) {
+    uint32_t LEDs = (sim_adaLEDs[frame] < sim_params.size) ? sim_adaLEDs[frame] : sim_params.size;
+
+    /* White of RGBW LEDs is not changed */
+    for (uint32_t ii = 0; ii < LEDs; ii++) {
+        memcpy(&colors[ii * sim_params.type], &sim_adaStream[sim_adaData[frame] + ii * 3u], 3u);
+        sim_expectLED(&expected[ii * sim_params.type], &colors[ii * sim_params.type]);
+    }
+    while (!smartLED_isUpdating(ada->smartled)) {
+        uint32_t chunk = 1u + rand() % sim_params.adalight;
+
+        if (sim_adaPos >= sim_adaLength) {
+            /* Last frame is presented once the reset of the previous transfer has elapsed, the start is retried by the caller */
+            if (ada->_state == SMARTLED_ADALIGHT_PRESENT) {
+                smartLED_parseAdalight(ada, &sim_adaStream[sim_adaPos], 0);
+                return smartLED_isUpdating(ada->smartled) ? SMARTLED_SUCCESS : SMARTLED_ERROR;
+            }
+            printf("Adalight frame %u was not presented\n", frame);
+            return SMARTLED_ERROR;
+        }
+        if (chunk > sim_adaLength - sim_adaPos) {
+            chunk = sim_adaLength - sim_adaPos;
+        }
+        sim_adaPos += smartLED_parseAdalight(ada, &sim_adaStream[sim_adaPos], chunk);
+    }
+    return SMARTLED_SUCCESS;
+}
+
+static int sim_update(smartLED_t* strip, uint8_t* colors, uint8_t* expected, uint32_t transfer) {
+    const uint8_t type = sim_params.type;
+    uint16_t first = (uint16_t)(rand() % sim_params.size);
+    uint16_t count = (uint16_t)(1u + rand() % (sim_params.size - first));
+    uint8_t* c = &colors[first * type];
+    uint8_t* random = malloc((uint32_t)count * type);
+    smartLED_retStatus_t ret = SMARTLED_SUCCESS;
+
+    for (uint32_t ii = 0; ii < (uint32_t)count * type; ii++) {
+        random[ii] = (uint8_t)rand();
+    }
+
+    switch (transfer % 6u) {
+        case 0:
+            memcpy(c, random, (uint32_t)count * type);
+            for (uint16_t ii = 0; ii < count; ii++) {
+                uint8_t* led = &c[ii * type];
+
+                if (type == SMARTLED_RGBW) {
+                    smartLED_updateRGBWColors(strip, first + ii, led[0], led[1], led[2], led[3]);
+                } else {
+                    smartLED_updateRGBColors(strip, first + ii, led[0], led[1], led[2]);
+                }
+            }
+            break;
+        case 1:
+            memcpy(c, random, (uint32_t)count * type);
+            ret = smartLED_blit(strip, first, count, random, SMARTLED_ORDER_RGB);
+            break;
+        case 2:
+            /* RGBW strips alternate between setting white and keeping it */
+            for (uint16_t ii = 0; ii < count; ii++) {
+                memcpy(&c[ii * type], random, ((type == SMARTLED_RGBW) && (transfer & 1u)) ? 4u : 3u);
+            }
+            if ((type == SMARTLED_RGBW) && (transfer & 1u)) {
+                ret = smartLED_fillRGBWRange(strip, first, count, random[0], random[1], random[2], random[3]);
+            } else {
+                ret = smartLED_fillRGBRange(strip, first, count, random[0], random[1], random[2]);
+            }
+            break;
+        case 3: {
+            /* Rotate by at least one position, or fill a single LED */
+            int16_t shift = (int16_t)((count > 1u) ? (1 + rand() % (count - 1)) : 0);
+
+            if (rand() & 1) {
+                shift = (int16_t)(shift - count);
+            }
+            for (uint16_t ii = 0; ii < count; ii++) {
+                memcpy(&random[(((ii + shift) % count + count) % count) * type], &c[ii * type], type);
+            }
+            memcpy(c, random, (uint32_t)count * type);
+            ret = (count > 1u) ? smartLED_rotateRange(strip, first, count, shift) : smartLED_fillRGBRange(strip, first, 1, c[0], c[1], c[2]);
+            break;
+        }
+        case 4: {
+            /* Copy a segment starting from a random LED, the ranges may overlap */
+            uint16_t source = (uint16_t)(rand() % (sim_params.size - count + 1u));
+
+            memmove(c, &colors[source * type], (uint32_t)count * type);
+            ret = smartLED_copyRange(strip, first, source, count);
+            break;
+        }
+        default:
+            for (uint16_t ii = 0; ii < count; ii++) {
+                uint32_t color = smartLED_HSVToRGB(random[ii * type], random[ii * type + 1], random[ii * type + 2]);
+
+                c[ii * type] = (uint8_t)(color >> 16);
+                c[ii * type + 1] = (uint8_t)(color >> 8);
+                c[ii * type + 2] = (uint8_t)color;
+                memmove(&random[ii * 3], &random[ii * type], 3);
+            }
+            ret = smartLED_blitHSV(strip, first, count, random);
+            break;
+    }
+    for (uint16_t ii = first; ii < first + count; ii++) {
+        sim_expectLED(&expected[ii * type], &colors[ii * type]);
+    }
+    free(random);
+
+    if (ret != SMARTLED_SUCCESS) {
+        printf("color function %u failed\n", transfer % 6u);
+        return -1;
+    }
+    return 0;
+}
+
+static void sim_usage(const char* name) {
+    printf("Usage: %s [options]\n"
+           "  -c chip        ws2811 or ws2812b (default ws2812b)\n"
+           "  -t type        rgb or rgbw (default rgb)\n"
+           "  -n size        number of LEDs (default 600)\n"
+           "  -l LEDperIRQ   LEDs refilled per IRQ (default 8)\n"
+           "  -b brightness  strip brightness, 0 to 255 (default 255)\n"
+           "  -a ARR         timer auto-reload value (default 104)\n"
+           "  -e ns          cost of encoding one LED in the IRQ (default 0)\n"
+           "  -i ns          fixed cost of each IRQ (default 0)\n"
+           "  -s seed        seed of the random colors (default 1)\n"
+           "  -r rate        stream at the given refresh rate in Hz, 0 for the highest one\n"
+           "  -f frames      number of streamed frames (default 3)\n"
+           "  -g             render colors with a pixel shader, without LED data array\n"
+           "  -k order       wire color order: grb, rgb, brg, rbg, gbr or bgr (default grb)\n"
+           "  -m bits        store 4 or 8-bit palette indices instead of colors\n"
+           "  -p lanes       drive 1 to 4 lanes of decreasing length in parallel from one timer\n"
+           "  -d             precompute the whole frame in a linear DMA buffer (full-frame mode)\n"
+           "  -u count       send count transfers after the first one, each changing a random range of LEDs\n"
+           "  -x frames      crossfade to new random colors over the given number of frames, streamed or one transfer each\n"
+           "  -z             use a strip defined by SMARTLED_DEFINE_STATIC, with its specialized encoder (600 LEDs, 8 per IRQ)\n"
+           "  -G strips      start 2 to 8 strips on separate timers as a strip group and measure their IRQ interleaving\n"
+           "  -A us          choose LEDperIRQ with smartLED_initAutoTune() for the given IRQ latency margin, IRQ costs default to the measured ones\n"
+           "  -B bytes       DMA buffer budget of -A (default 4096)\n"
+           "  -w bytes       send frames as an Adalight stream parsed in random chunks of up to the given size\n"
+           "  -D             double buffer, updates are presented and every other transfer sends the front buffer again\n"
+#ifdef SMARTLED_USE_SPI
+           "  -o output      pwm, spi3 or spi4 (default pwm)\n"
+#endif /* SMARTLED_USE_SPI */
+           ,
+           name);
+}
+
+static int sim_parseArgs(int argc, char** argv, simParams_t* params) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:t:n:l:b:a:e:i:s:r:f:gk:m:p:du:x:zG:A:B:w:Do:h")) != -1) {
+        switch (opt) {
+            case 'c': params->chip = (strcmp(optarg, "ws2811") == 0) ? WS2811 : WS2812B; break;
+            case 't': params->type = (strcmp(optarg, "rgbw") == 0) ? SMARTLED_RGBW : SMARTLED_RGB; break;
+            case 'n': params->size = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'l': params->LEDperIRQ = (uint8_t)strtoul(optarg, NULL, 0); break;
+            case 'b': params->brightness = (uint8_t)strtoul(optarg, NULL, 0); break;
+            case 'a': params->ARR = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'e': params->encodeNs = strtod(optarg, NULL); break;
+            case 'i': params->IRQNs = strtod(optarg, NULL); break;
+            case 's': params->seed = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'r':
+                params->refreshRate = (uint16_t)strtoul(optarg, NULL, 0);
+                params->streaming = 1;
+                break;
+            case 'f': params->frames = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'g': params->shader = 1; break;
+            case 'k':
+                for (uint8_t ii = 0; ii < 6u; ii++) {
+                    if (strcmp(optarg, sim_orderNames[ii]) == 0) {
+                        params->colorOrder = (smartLEDColorOrder_t)ii;
+                    }
+                }
+                break;
+            case 'm': params->palette = (strtoul(optarg, NULL, 0) == 4) ? SMARTLED_PALETTE_4BIT : SMARTLED_PALETTE_8BIT; break;
+            case 'p': params->lanes = (uint8_t)strtoul(optarg, NULL, 0); break;
+            case 'd': params->dmaMode = SMARTLED_DMA_FULLFRAME; break;
+            case 'u': params->updates = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'x': params->fade = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'z': params->staticDef = 1; break;
+            case 'G': params->group = (uint8_t)strtoul(optarg, NULL, 0); break;
+            case 'A':
+                params->marginUs = (uint16_t)strtoul(optarg, NULL, 0);
+                params->autoTune = 1;
+                break;
+            case 'B': params->RAMBudget = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': params->adalight = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'D': params->doubleBuffer = 1; break;
+#ifdef SMARTLED_USE_SPI
+            case 'o':
+                params->output = (strcmp(optarg, "spi3") == 0)   ? SMARTLED_OUTPUT_SPI_3BIT
+                                 : (strcmp(optarg, "spi4") == 0) ? SMARTLED_OUTPUT_SPI_4BIT
+                                                                 : SMARTLED_OUTPUT_PWM;
+                break;
+#endif /* SMARTLED_USE_SPI */
+            default: sim_usage(argv[0]); return -1;
+        }
+    }
+    return 0;
+}
+
+/* Worst wait of an IRQ behind the previous ones on a single core, each IRQ lasting durationNs, for IRQ times in increasing order */
+static double sim_worstLatency(const double* IRQAt, uint32_t IRQs, double durationNs) {
+    double freeAt = 0, worst = 0;
+
+    for (uint32_t ii = 0; ii < IRQs; ii++) {
+        double serviceAt = (IRQAt[ii] > freeAt) ? IRQAt[ii] : freeAt;
+
+        if (serviceAt - IRQAt[ii] > worst) {
+            worst = serviceAt - IRQAt[ii];
+        }
+        freeAt = serviceAt + durationNs;
+    }
+    return worst;
+}
+
+/* Shortest time between two consecutive IRQs, for IRQ times in increasing order */
+static double sim_minSpacing(const double* IRQAt, uint32_t IRQs) {
+    double spacing = -1.0;
+
+    for (uint32_t ii = 1; ii < IRQs; ii++) {
+        if ((spacing < 0) || (IRQAt[ii] - IRQAt[ii - 1u] < spacing)) {
+            spacing = IRQAt[ii] - IRQAt[ii - 1u];
+        }
+    }
+    return spacing;
+}
+
+static int sim_compareTimes(const void* a, const void* b) {
+    double ta = *(const double*)a, tb = *(const double*)b;
+
+    return (ta > tb) - (ta < tb);
+}
+
+/* Strips with the same parameters on separate timers, presented by smartLED_presentGroup() and sent concurrently */
+static int sim_group(const simParams_t* params) {
+    TIM_TypeDef timRegs[SMARTLED_GROUP_MAX_STRIPS] = {0};
+    DMA_HandleTypeDef timDMA[SMARTLED_GROUP_MAX_STRIPS] = {0};
+    TIM_HandleTypeDef htim[SMARTLED_GROUP_MAX_STRIPS] = {0};
+    smartLED_t strips[SMARTLED_GROUP_MAX_STRIPS] = {0};
+    simDecoder_t dec[SMARTLED_GROUP_MAX_STRIPS] = {0};
+    smartLEDGroup_t group = {.stripsNum = params->group};
+    double startNs[SMARTLED_GROUP_MAX_STRIPS], *IRQAt, *alignedAt, phaseNs, durationNs = params->IRQNs + params->encodeNs * params->LEDperIRQ;
+    uint32_t pos[SMARTLED_GROUP_MAX_STRIPS] = {0}, elements[SMARTLED_GROUP_MAX_STRIPS] = {0}, IRQs = 0, maxIRQs, frames = 0, badFrames = 0;
+    uint8_t colors[4];
+    int ret = 0;
+
+    for (uint8_t ss = 0; ss < params->group; ss++) {
+        timRegs[ss].ARR = params->ARR;
+        htim[ss].Instance = &timRegs[ss];
+        htim[ss].hdma[TIM_DMA_ID_CC1] = &timDMA[ss];
+        strips[ss].chip = params->chip;
+        strips[ss].type = params->type;
+        strips[ss].size = params->size;
+        strips[ss].colorOrder = params->colorOrder;
+        strips[ss].htim = &htim[ss];
+        strips[ss].timType = SMARTLED_TIMER_NORMAL;
+        strips[ss].timChannel = TIM_CHANNEL_1;
+        strips[ss].LEDperIRQ = params->LEDperIRQ;
+        if (((ss & 1u) ? smartLED_initDoubleBuffer(&strips[ss]) : smartLED_init(&strips[ss])) != SMARTLED_SUCCESS) {
+            printf("smartLED_init failed\n");
+            return 2;
+        }
+        group.strips[ss] = &strips[ss];
+    }
+    if (smartLED_initGroup(&group) != SMARTLED_SUCCESS) {
+        printf("smartLED_initGroup failed\n");
+        return 2;
+    }
+
+    /* Random colors on each strip, first frame of a dithered strip is rounded as without dithering */
+    srand(params->seed);
+    for (uint8_t ss = 0; ss < params->group; ss++) {
+        dec[ss].nExpected = (uint32_t)params->type * params->size;
+        dec[ss].expected = malloc(dec[ss].nExpected);
+        dec[ss].bytes = calloc(dec[ss].nExpected, sizeof(uint8_t));
+        dec[ss].resetBits = (uint64_t)(sim_resetNs(params->chip) / SIM_BIT_NS);
+        dec[ss].minGap = UINT64_MAX;
+        smartLED_setBrightness(&strips[ss], params->brightness);
+        for (uint16_t ii = 0; ii < params->size; ii++) {
+            for (uint8_t cc = 0; cc < params->type; cc++) {
+                colors[cc] = (uint8_t)rand();
+            }
+            if (params->type == SMARTLED_RGBW) {
+                smartLED_updateRGBWColors(&strips[ss], ii, colors[0], colors[1], colors[2], colors[3]);
+            } else {
+                smartLED_updateRGBColors(&strips[ss], ii, colors[0], colors[1], colors[2]);
+            }
+            sim_expectLED(&dec[ss].expected[ii * params->type], colors);
+        }
+    }
+
+    /* Odd strips are double buffered, smartLED_presentGroup() swaps their buffers and starts the even ones as they are */
+    if ((smartLED_presentGroup(&group) != SMARTLED_SUCCESS) || !smartLED_isGroupUpdating(&group) || (smartLED_startGroupTransfer(&group) == SMARTLED_SUCCESS)) {
+        printf("group transfer start failed\n");
+        return 2;
+    }
+
+    /* Each DMA starts when the driver started it, as measured by the stub on the 1 GHz cycle counter */
+    phaseNs = group._phaseCycles * (1e9 / SystemCoreClock);
+    for (uint8_t ss = 0; ss < params->group; ss++) {
+        startNs[ss] = (uint32_t)(htim[ss].stubStartCycles - htim[0].stubStartCycles) * (1e9 / SystemCoreClock);
+        if (startNs[ss] < ss * phaseNs) {
+            printf("strip %u started %.1f us after the first one, %.1f us expected\n", ss, startNs[ss] / 1000.0, ss * phaseNs / 1000.0);
+            ret = 1;
+        }
+    }
+    maxIRQs = params->group * (2u * ((uint32_t)params->size / params->LEDperIRQ + strips[0]._resetBlocks / params->LEDperIRQ) + 8u);
+    IRQAt = malloc(maxIRQs * sizeof(double));
+    alignedAt = malloc(maxIRQs * sizeof(double));
+
+    /* Send one element at a time from the strip whose next element comes first */
+    while ((IRQs < maxIRQs) && smartLED_isGroupUpdating(&group)) {
+        uint8_t next = SMARTLED_GROUP_MAX_STRIPS;
+        double t = 0;
+
+        for (uint8_t ss = 0; ss < params->group; ss++) {
+            double at = startNs[ss] + elements[ss] * SIM_BIT_NS;
+
+            if (htim[ss].stubRunning && ((next == SMARTLED_GROUP_MAX_STRIPS) || (at < t))) {
+                next = ss;
+                t = at;
+            }
+        }
+        if (next == SMARTLED_GROUP_MAX_STRIPS) {
+            break;
+        }
+
+        uint8_t* DMA = (uint8_t*)htim[next].stubBuffer;
+        uint32_t len = htim[next].stubLength;
+
+        sim_decodePWM(&dec[next], &strips[next], DMA[pos[next]], t);
+        pos[next]++;
+        elements[next]++;
+        if ((pos[next] == len / 2u) || (pos[next] == len)) {
+            IRQAt[IRQs] = t + SIM_BIT_NS;
+            alignedAt[IRQs] = IRQAt[IRQs] - startNs[next];
+            IRQs++;
+            smartLED_updateTransfer(&strips[next], (pos[next] == len) ? SMARTLED_IRQ_FINISHED : SMARTLED_IRQ_HALFCPLT);
+            pos[next] %= len;
+        }
+    }
+    qsort(alignedAt, IRQs, sizeof(double), sim_compareTimes);
+
+    printf("group of %u strips: %s, %u LEDs, LEDperIRQ %u, started every %.1f us (half buffer %.1f us)\n", params->group,
+           (params->type == SMARTLED_RGBW) ? "RGBW" : "RGB", params->size, params->LEDperIRQ, phaseNs / 1000.0,
+           params->LEDperIRQ * strips[0]._LEDBits * SIM_BIT_NS / 1000.0);
+    printf("start offsets (us):");
+    for (uint8_t ss = 0; ss < params->group; ss++) {
+        printf(" %.1f", startNs[ss] / 1000.0);
+    }
+    printf("\nshortest time between two IRQs: %.1f us staggered, %.1f us if started together\n", sim_minSpacing(IRQAt, IRQs) / 1000.0,
+           sim_minSpacing(alignedAt, IRQs) / 1000.0);
+    printf("worst IRQ latency for %.1f us IRQs: %.1f us staggered, %.1f us if started together\n", durationNs / 1000.0,
+           sim_worstLatency(IRQAt, IRQs, durationNs) / 1000.0, sim_worstLatency(alignedAt, IRQs, durationNs) / 1000.0);
+
+    for (uint8_t ss = 0; ss < params->group; ss++) {
+        if (dec[ss].started) {
+            sim_frameEnd(&dec[ss]);
+        }
+        frames += dec[ss].frames;
+        badFrames += dec[ss].badFrames + dec[ss].invalid + dec[ss].gaps;
+        if ((dec[ss].frames != 1u) || (!SIM_TIMED_RESET && (dec[ss].idleRun < dec[ss].resetBits))) {
+            ret = 1;
+        }
+        free(dec[ss].expected);
+        free(dec[ss].bytes);
+    }
+    printf("%u IRQs, %u frames decoded, %u wrong\n", IRQs, frames, badFrames);
+    if (smartLED_isGroupUpdating(&group)) {
+        printf("group transfer did not complete\n");
+        ret = 1;
+    }
+    if (badFrames) {
+        ret = 1;
+    }
+
+    free(IRQAt);
+    free(alignedAt);
+    return ret;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+    simParams_t params = {
+        .chip = WS2812B, .type = SMARTLED_RGB, .size = 600, .LEDperIRQ = 8, .brightness = 255, .ARR = 104, .seed = 1, .frames = 3, .RAMBudget = 4096};
+    TIM_TypeDef timRegs = {0};
+    DMA_HandleTypeDef timDMA = {0};
+    TIM_HandleTypeDef htim = {.Instance = &timRegs};
+#ifdef SMARTLED_USE_SPI
+    DMA_HandleTypeDef SPIDMA = {0};
+    SPI_HandleTypeDef hspi = {.hdmatx = &SPIDMA};
+#endif /* SMARTLED_USE_SPI */
+    DMA_HandleTypeDef* hdma = &timDMA;
+    smartLED_t strips[SMARTLED_PARALLEL_MAX_LANES] = {0};
+    smartLEDParallel_t parallel = {0};
+    smartLEDAdalight_t ada = {0};
+    simDecoder_t dec[SMARTLED_PARALLEL_MAX_LANES] = {0};
+    uint8_t *colors[SMARTLED_PARALLEL_MAX_LANES], *expected[SMARTLED_PARALLEL_MAX_LANES], *stale = NULL, *DMA;
+    uint8_t *frontColors = NULL, *frontExpected = NULL;
+    double *readyAt = NULL, t = 0, elementNs = SIM_BIT_NS, budgetNs, worstNs, resetNs = -1.0, gapNs = -1.0;
+    uint8_t* running = &htim.stubRunning;
+    uint32_t *startCycles = &htim.stubStartCycles, *stopCycles = &htim.stubStopCycles;
+    uint32_t len, half, blockLen, pos, IRQs = 0, overruns = 0, frames = 0, badFrames = 0, invalid = 0, gaps = 0;
+    uint8_t lanesNum, leftLow, retryExpired;
+    uint32_t retryStart, fadeTransfers = 0;
+    uint64_t stopIdle = UINT64_MAX;
+#ifdef SMARTLED_USE_STATS
+    double transferStart;
+#endif /* SMARTLED_USE_STATS */
+    smartLED_retStatus_t started;
+    int ret = 0;
+
+    if (sim_parseArgs(argc, argv, &params) != 0) {
+        return 2;
+    }
+    lanesNum = params.lanes ? params.lanes : 1u;
+    if ((lanesNum > SMARTLED_PARALLEL_MAX_LANES) || (params.lanes && (params.streaming || params.shader))) {
+        printf("parallel lanes must be 1 to %u, without streaming and shader\n", SMARTLED_PARALLEL_MAX_LANES);
+        return 2;
+    }
+    if ((params.updates || params.fade) && (params.lanes || params.shader || params.palette)) {
+        printf("partial updates and crossfades are only simulated on a single strip in plain color mode\n");
+        return 2;
+    }
+    if (params.updates && (params.streaming || (params.fade && !params.doubleBuffer))) {
+        printf("partial updates are not simulated while streaming, nor after a crossfade without double buffer option\n");
+        return 2;
+    }
+    if (params.doubleBuffer
+        && (params.lanes || params.shader || params.palette || params.streaming || params.adalight || params.staticDef || params.autoTune)) {
+        printf("double buffer is only simulated on a single strip in plain color mode, with direct transfers\n");
+        return 2;
+    }
+
+    if (params.staticDef
+        && ((params.size != SIM_STATIC_SIZE) || (params.LEDperIRQ != SIM_STATIC_LEDPERIRQ) || params.lanes || params.shader || params.palette || params.fade
+            || (params.dmaMode != SMARTLED_DMA_CIRCULAR))) {
+        printf("static strips have %u LEDs and %u LEDs per IRQ, in circular mode with a single buffer of colors\n", SIM_STATIC_SIZE, SIM_STATIC_LEDPERIRQ);
+        return 2;
+    }
+
+    if (params.group) {
+        if ((params.group < 2u) || (params.group > SMARTLED_GROUP_MAX_STRIPS) || params.lanes || params.shader || params.palette || params.fade
+            || params.updates || params.streaming || params.staticDef || (params.dmaMode != SMARTLED_DMA_CIRCULAR)) {
+            printf("strip groups are simulated with 2 to %u strips of colors in circular mode, one transfer each\n", SMARTLED_GROUP_MAX_STRIPS);
+            return 2;
+        }
+    }
+
+    if (params.autoTune && (params.lanes || params.shader || params.fade || params.staticDef || params.group || (params.dmaMode != SMARTLED_DMA_CIRCULAR))) {
+        printf("LEDperIRQ is tuned on a single strip of colors in circular mode\n");
+        return 2;
+    }
+
+    if (params.adalight
+        && ((params.frames < 1u) || params.lanes || params.shader || params.palette || params.fade || params.updates || params.streaming || params.group)) {
+        printf("Adalight frames are simulated on a single strip of colors, one transfer each\n");
+        return 2;
+    }
+
+    /* Without streaming, one transfer per crossfade step, followed by the updates */
+    if (params.fade && !params.streaming) {
+        fadeTransfers = params.fade;
+        params.updates += params.fade - 1u;
+    }
+    if (params.adalight) {
+        params.updates = params.frames - 1u;
+    }
+    sim_params = params;
+#ifdef SMARTLED_USE_COLOR_TABLE
+    for (uint32_t ii = 0; ii < 256u; ii++) {
+#ifdef SMARTLED_USE_GAMMA
+        uint32_t value = (uint32_t)lround(65280.0 * pow(ii / 255.0, 2.6));
+#else
+        uint32_t value = ii << 8;
+#endif /* SMARTLED_USE_GAMMA */
+        sim_colorTable[ii] = (uint16_t)((value * params.brightness) / 0xFF);
+    }
+#endif /* SMARTLED_USE_COLOR_TABLE */
+    if (params.group) {
+        return sim_group(&params);
+    }
+    htim.hdma[TIM_DMA_ID_CC1] = &timDMA;
+
+    timRegs.ARR = params.ARR;
+    for (uint8_t ll = 0; ll < lanesNum; ll++) {
+        strips[ll].chip = params.chip;
+        strips[ll].type = params.type;
+        strips[ll].size = (uint16_t)(params.size - (ll * params.size) / (2u * lanesNum));
+        strips[ll].palette = params.palette;
+        strips[ll].colorOrder = params.colorOrder;
+    }
+    if (params.lanes) {
+        parallel.htim = &htim;
+        parallel.lanesNum = params.lanes;
+        parallel.LEDperIRQ = params.LEDperIRQ;
+        for (uint8_t ll = 0; ll < lanesNum; ll++) {
+            parallel.lanes[ll] = &strips[ll];
+        }
+        if (smartLED_initParallel(&parallel) != SMARTLED_SUCCESS) {
+            printf("smartLED_initParallel failed\n");
+            return 2;
+        }
+    } else {
+        strips[0].htim = &htim;
+        strips[0].timType = SMARTLED_TIMER_NORMAL;
+        strips[0].timChannel = TIM_CHANNEL_1;
+        strips[0].LEDperIRQ = params.LEDperIRQ;
+        strips[0].dmaMode = params.dmaMode;
+#ifdef SMARTLED_USE_SPI
+        strips[0].output = params.output;
+        strips[0].hspi = &hspi;
+#endif /* SMARTLED_USE_SPI */
+        if (params.staticDef) {
+            smartLED_t* staticStrip = (params.type == SMARTLED_RGB) ? &sim_staticRGB : &sim_staticRGBW;
+            smartLED_retStatus_t status;
+
+            /* Configure the static strip, then simulate a copy of it: the driver keeps no pointer to the struct */
+            staticStrip->chip = strips[0].chip;
+            staticStrip->colorOrder = strips[0].colorOrder;
+            staticStrip->htim = strips[0].htim;
+            staticStrip->timType = strips[0].timType;
+            staticStrip->timChannel = strips[0].timChannel;
+#ifdef SMARTLED_USE_SPI
+            staticStrip->output = strips[0].output;
+            staticStrip->hspi = strips[0].hspi;
+#endif /* SMARTLED_USE_SPI */
+            status = (params.type == SMARTLED_RGB) ? sim_staticRGB_init() : sim_staticRGBW_init();
+            if (status != SMARTLED_SUCCESS) {
+                printf("static strip init failed\n");
+                return 2;
+            }
+            strips[0] = *staticStrip;
+        } else if (params.autoTune) {
+            smartLEDTuning_t tuning;
+
+            if (smartLED_initAutoTune(&strips[0], params.RAMBudget, params.marginUs, &tuning) != SMARTLED_SUCCESS) {
+                printf("smartLED_initAutoTune failed: %u cycles per LED, no LEDperIRQ leaves %u us within %u bytes\n", tuning.encodeCycles, params.marginUs,
+                       params.RAMBudget);
+                return 2;
+            }
+            printf("tuned LEDperIRQ %u: %u cycles per LED, IRQ %u of %u cycles, %u cycles of margin, DMA buffer %u bytes\n", tuning.LEDperIRQ,
+                   tuning.encodeCycles, tuning.IRQCycles, tuning.halfCycles, tuning.marginCycles, tuning.DMABufferSize);
+
+            /* The stub counter runs at 1 GHz, so cycles are ns */
+            params.LEDperIRQ = tuning.LEDperIRQ;
+            if ((params.encodeNs == 0) && (params.IRQNs == 0)) {
+                params.encodeNs = tuning.encodeCycles * (1e9 / SystemCoreClock);
+                params.IRQNs = SMARTLED_IRQ_OVERHEAD_CYCLES * (1e9 / SystemCoreClock);
+            }
+            sim_params = params;
+        } else if ((params.shader ? smartLED_initShader(&strips[0], sim_shader)
+                           : ((params.fade || params.doubleBuffer) ? smartLED_initDoubleBuffer(&strips[0]) : smartLED_init(&strips[0])))
+            != SMARTLED_SUCCESS) {
+            printf("smartLED_init failed\n");
+            return 2;
+        }
+    }
+
+    /* Random colors, and the wire order byte stream the first chip of each lane is expected to receive */
+    srand(params.seed);
+    for (uint8_t ll = 0; ll < lanesNum; ll++) {
+        smartLED_t* strip = &strips[ll];
+
+        smartLED_setBrightness(strip, params.brightness);
+        dec[ll].nExpected = (uint32_t)params.type * strip->size;
+        colors[ll] = malloc((uint32_t)params.type * ((strip->size > 256u) ? strip->size : 256u));
+        expected[ll] = malloc(dec[ll].nExpected);
+        dec[ll].expected = expected[ll];
+        dec[ll].bytes = calloc(dec[ll].nExpected, sizeof(uint8_t));
+        dec[ll].resetBits = (uint64_t)(sim_resetNs(params.chip) / SIM_BIT_NS);
+        dec[ll].minGap = UINT64_MAX;
+        for (uint32_t ii = 0; ii < (uint32_t)params.type * ((strip->size > 256u) ? strip->size : 256u); ii++) {
+            colors[ll][ii] = (uint8_t)rand();
+        }
+        if (params.shader) {
+            dec[ll].expect = sim_shaderExpected;
+            continue;
+        }
+#ifdef SMARTLED_USE_DITHERING
+        if (params.palette == SMARTLED_PALETTE_NONE) {
+            sim_strips = strips;
+            sim_colors[ll] = colors[ll];
+            sim_expected[ll] = expected[ll];
+            sim_error[ll] = malloc(dec[ll].nExpected);
+            memset(sim_error[ll], 0x80, dec[ll].nExpected);
+            dec[ll].expect = sim_ditherExpected;
+        }
+#endif /* SMARTLED_USE_DITHERING */
+        if (params.palette != SMARTLED_PALETTE_NONE) {
+            /* Random palette, and LEDs pointing to random entries */
+            for (uint16_t ii = 0; ii < (1u << params.palette); ii++) {
+                uint8_t* c = &colors[ll][ii * params.type];
+
+                if (params.type == SMARTLED_RGBW) {
+                    smartLED_setPaletteRGBWColors(strip, ii, c[0], c[1], c[2], c[3]);
+                } else {
+                    smartLED_setPaletteRGBColors(strip, ii, c[0], c[1], c[2]);
+                }
+            }
+        }
+        for (uint16_t ii = 0; ii < strip->size; ii++) {
+            uint8_t* c = &colors[ll][ii * params.type];
+            uint8_t* e = &expected[ll][ii * params.type];
+
+            if (params.palette != SMARTLED_PALETTE_NONE) {
+                uint8_t index = colors[ll][ii * params.type] & ((1u << params.palette) - 1u);
+
+                smartLED_updateIndex(strip, ii, index);
+                c = &colors[ll][index * params.type];
+            } else if (params.type == SMARTLED_RGBW) {
+                smartLED_updateRGBWColors(strip, ii, c[0], c[1], c[2], c[3]);
+            } else {
+                smartLED_updateRGBColors(strip, ii, c[0], c[1], c[2]);
+            }
+            sim_expectLED(e, c);
+        }
+    }
+
+    if (params.adalight) {
+        if (smartLED_initAdalight(&ada, &strips[0]) != SMARTLED_SUCCESS) {
+            printf("smartLED_initAdalight failed\n");
+            return 2;
+        }
+        sim_adalightStream(params.frames);
+    }
+
+    /* The colors set so far are in the back buffer, the front one starts cleared */
+    if (params.doubleBuffer) {
+        frontColors = calloc((uint32_t)params.type * params.size, sizeof(uint8_t));
+        frontExpected = calloc((uint32_t)params.type * params.size, sizeof(uint8_t));
+    }
+
+    /* The colors set so far are sent as the front buffer, new random colors are written to the back buffer and faded in */
+    if (params.fade) {
+        uint32_t bytes = (uint32_t)params.type * params.size;
+
+        sim_fadeFrom = colors[0];
+        sim_fadeTo = malloc(bytes);
+        sim_blended = malloc(bytes);
+        memcpy(strips[0]._txData, strips[0]._colorsData, bytes);
+        for (uint16_t ii = 0; ii < params.size; ii++) {
+            uint8_t* c = &sim_fadeTo[ii * params.type];
+
+            for (uint8_t cc = 0; cc < params.type; cc++) {
+                c[cc] = (uint8_t)rand();
+            }
+            if (params.type == SMARTLED_RGBW) {
+                smartLED_updateRGBWColors(&strips[0], ii, c[0], c[1], c[2], c[3]);
+            } else {
+                smartLED_updateRGBColors(&strips[0], ii, c[0], c[1], c[2]);
+            }
+        }
+        if (smartLED_crossfade(&strips[0], params.fade) != SMARTLED_SUCCESS) {
+            printf("smartLED_crossfade failed\n");
+            return 2;
+        }
+        dec[0].expect = sim_fadeExpected;
+#ifdef SMARTLED_USE_DITHERING
+        sim_colors[0] = sim_blended;
+#endif /* SMARTLED_USE_DITHERING */
+    }
+
+    for (uint32_t transfer = 0; transfer <= params.updates; transfer++) {
+        /* Crossfade complete, its target colors are updated from now on */
+        if (fadeTransfers && (transfer == fadeTransfers)) {
+            memcpy(colors[0], sim_fadeTo, (uint32_t)params.type * params.size);
+            for (uint32_t ii = 0; ii < (uint32_t)params.type * params.size; ii += params.type) {
+                sim_expectLED(&expected[0][ii], &colors[0][ii]);
+            }
+            memcpy(frontColors, colors[0], (uint32_t)params.type * params.size);
+            memcpy(frontExpected, expected[0], (uint32_t)params.type * params.size);
+#ifdef SMARTLED_USE_DITHERING
+            dec[0].expect = sim_ditherExpected;
+#else
+            dec[0].expect = NULL;
+#endif /* SMARTLED_USE_DITHERING */
+        }
+        if (transfer && (transfer >= fadeTransfers) && !params.adalight) {
+            if (sim_update(&strips[0], colors[0], expected[0], transfer) != 0) {
+                ret = 1;
+            }
+        }
+
+        /* Starts are retried as the application would while the reset runs, for up to twice its length. The deadline is checked before
+         * each start, so that the last one is tried after it even if the simulator is preempted */
+        retryStart = SMARTLED_GET_CYCLES();
+        do {
+            retryExpired = (SMARTLED_GET_CYCLES() - retryStart) >= (uint32_t)(2.0 * sim_resetNs(params.chip) * (SystemCoreClock / 1e9));
+            if (params.lanes) {
+                started = smartLED_startParallelTransfer(&parallel);
+            } else if (params.adalight) {
+                started = sim_adalightFeed(&ada, colors[0], expected[0], transfer);
+                dec[0].nExpected = (uint32_t)params.type * ((params.dmaMode == SMARTLED_DMA_FULLFRAME) ? params.size : strips[0]._frameSize);
+            } else if (params.doubleBuffer && (transfer >= fadeTransfers) && (transfer & 1u)) {
+                /* Front buffer is sent whole again, changes of the back buffer are left to the next present */
+                started = smartLED_startTransfer(&strips[0]);
+                dec[0].expected = frontExpected;
+                dec[0].nExpected = (uint32_t)params.type * params.size;
+#ifdef SMARTLED_USE_DITHERING
+                sim_colors[0] = frontColors;
+                sim_expected[0] = frontExpected;
+#endif /* SMARTLED_USE_DITHERING */
+                if ((started == SMARTLED_SUCCESS) && (strips[0]._frameSize != params.size)) {
+                    printf("transfer %u: %u LEDs of the front buffer sent instead of %u\n", transfer, strips[0]._frameSize, params.size);
+                    ret = 1;
+                }
+            } else if (params.doubleBuffer && (transfer >= fadeTransfers)) {
+                /* Every LED changed in the back buffer since the previous present must be sent */
+                uint32_t changedEnd = 0;
+
+                for (uint32_t ii = 0; ii < (uint32_t)params.type * params.size; ii++) {
+                    if (frontColors[ii] != colors[0][ii]) {
+                        changedEnd = ii / params.type + 1u;
+                    }
+                }
+                started = smartLED_present(&strips[0]);
+                dec[0].expected = expected[0];
+                dec[0].nExpected = (uint32_t)params.type * ((params.dmaMode == SMARTLED_DMA_FULLFRAME) ? params.size : strips[0]._frameSize);
+#ifdef SMARTLED_USE_DITHERING
+                sim_colors[0] = colors[0];
+                sim_expected[0] = expected[0];
+#endif /* SMARTLED_USE_DITHERING */
+                if ((started == SMARTLED_SUCCESS) && (strips[0]._frameSize < changedEnd)) {
+                    printf("transfer %u: %u LEDs presented, LED %u changed\n", transfer, strips[0]._frameSize, changedEnd - 1u);
+                    ret = 1;
+                }
+                memcpy(frontColors, colors[0], (uint32_t)params.type * params.size);
+                memcpy(frontExpected, expected[0], (uint32_t)params.type * params.size);
+            } else if (params.streaming) {
+                sim_framesRequested = params.frames;
+                started = smartLED_startStreaming(&strips[0], params.refreshRate, sim_frameCallback);
+            } else {
+                started = smartLED_startTransfer(&strips[0]);
+                /* A full-frame buffer always holds the whole strip, a circular one is only refilled up to the last changed LED */
+                dec[0].nExpected = (uint32_t)params.type * ((params.dmaMode == SMARTLED_DMA_FULLFRAME) ? params.size : strips[0]._frameSize);
+            }
+        } while (SIM_TIMED_RESET && (started != SMARTLED_SUCCESS) && !retryExpired);
+        DMA = (uint8_t*)htim.stubBuffer;
+        len = htim.stubLength;
+#ifdef SMARTLED_USE_SPI
+        if (params.output != SMARTLED_OUTPUT_PWM) {
+            running = &hspi.stubRunning;
+            startCycles = &hspi.stubStartCycles;
+            stopCycles = &hspi.stubStopCycles;
+            hdma = &SPIDMA;
+            DMA = hspi.stubBuffer;
+            len = hspi.stubLength;
+            elementNs = SIM_BIT_NS * 8u / params.output;
+        }
+#endif /* SMARTLED_USE_SPI */
+        if ((started != SMARTLED_SUCCESS) || !*running) {
+            printf("transfer start failed\n");
+            return 2;
+        }
+
+        /* Reset between the previous transfer and this one, including the time the line was left low after the DMA stop */
+        if (gapNs >= 0) {
+#ifdef SMARTLED_USE_TIMED_RESET
+            gapNs += (uint32_t)(*startCycles - *stopCycles) * (1e9 / SystemCoreClock);
+#else
+            (void)startCycles;
+            (void)stopCycles;
+#endif /* SMARTLED_USE_TIMED_RESET */
+            if ((resetNs < 0) || (gapNs < resetNs)) {
+                resetNs = gapNs;
+            }
+        }
+        pos = 0;
+        half = len / 2u;
+#ifdef SMARTLED_USE_STATS
+        transferStart = t;
+#endif /* SMARTLED_USE_STATS */
+        blockLen = (uint32_t)strips[0]._LEDBytes * lanesNum;
+        free(stale);
+        free(readyAt);
+        stale = calloc(len, sizeof(uint8_t));
+        readyAt = calloc(len, sizeof(double));
+
+        /* Worst-case IRQ duration compared to the time the DMA needs to come back to the refilled half */
+        budgetNs = (half / lanesNum) * elementNs;
+        worstNs = params.IRQNs + params.encodeNs * params.LEDperIRQ * lanesNum;
+
+        if (!transfer) {
+            printf("chip %s, %s, %u LEDs, LEDperIRQ %u, PWM %u kHz, pulses %u/%u of %u\n", (params.chip == WS2811) ? "WS2811" : "WS2812B",
+                   (params.type == SMARTLED_RGBW) ? "RGBW" : "RGB", params.size, params.LEDperIRQ, SMARTLED_PWM_FREQ, strips[0]._pulseLow,
+                   strips[0]._pulseHigh, params.ARR);
+#ifdef SMARTLED_USE_SPI
+            if (params.output != SMARTLED_OUTPUT_PWM) {
+                printf("SPI output, %u SPI bits per LED bit, %u bytes per LED\n", params.output, strips[0]._LEDBytes);
+            }
+#endif /* SMARTLED_USE_SPI */
+            if (params.lanes) {
+                printf("%u parallel lanes of", lanesNum);
+                for (uint8_t ll = 0; ll < lanesNum; ll++) {
+                    printf(" %u", strips[ll].size);
+                }
+                printf(" LEDs, DMA burst of %u transfers\n", (htim.stubBurstLength >> 8) + 1u);
+            }
+            if (params.dmaMode == SMARTLED_DMA_FULLFRAME) {
+                printf("full-frame buffer of %u slots (%u reset blocks) = %.1f us, one IRQ per frame\n", len, strips[0]._resetBlocks,
+                       len * elementNs / 1000.0);
+            } else {
+                printf("half buffer %u slots = %.1f us, worst-case IRQ %.1f us (%.0f%% of budget)\n", half, budgetNs / 1000.0,
+                       worstNs / 1000.0, 100.0 * worstNs / budgetNs);
+            }
+        }
+
+        /* One DMA element per lane and PWM period or per SPI byte, IRQ at half (unless disabled) and full buffer */
+        for (uint32_t nn = 0; *running && (nn < SIM_MAX_ELEMENTS); nn++) {
+            uint8_t value = DMA[pos];
+            uint8_t lane = (uint8_t)(pos % lanesNum);
+
+            /* Element read before the IRQ refilled it: the DMA sends the previous content */
+            if (t < readyAt[pos]) {
+                value = stale[pos];
+                if (value != DMA[pos]) {
+                    if (overruns < SIM_MAX_REPORTED) {
+                        printf("overrun at %.2f us: slot %u read %.2f us before refill\n", t / 1000.0, pos, (readyAt[pos] - t) / 1000.0);
+                    }
+                    overruns++;
+                }
+            }
+#ifdef SMARTLED_USE_SPI
+            if (params.output != SMARTLED_OUTPUT_PWM) {
+                sim_decodeSPI(&dec[0], params.output, value, t);
+            } else
+#endif /* SMARTLED_USE_SPI */
+            {
+                sim_decodePWM(&dec[lane], &strips[lane], value, t);
+            }
+            pos++;
+
+            /* All lanes of a PWM period are loaded by the same burst */
+            if (lane == (lanesNum - 1u)) {
+                t += elementNs;
+            }
+
+            if (((pos == half) && !(hdma->stubDisabledIT & DMA_IT_HT)) || (pos == len)) {
+                smartLEDIRQType_t IRQ = (pos == half) ? SMARTLED_IRQ_HALFCPLT : SMARTLED_IRQ_FINISHED;
+                uint32_t refillStart = (IRQ == SMARTLED_IRQ_HALFCPLT) ? 0 : half;
+
+                memcpy(&stale[refillStart], &DMA[refillStart], half);
+#ifdef SMARTLED_USE_STATS
+                /* Driver stats are timed by the cycle counter, so the IRQ is not called before the real time it would fire at */
+                while (!params.lanes && ((double)(uint32_t)(SMARTLED_GET_CYCLES() - *startCycles) < (t - transferStart) * (SystemCoreClock / 1e9))) {
+                }
+#endif /* SMARTLED_USE_STATS */
+                if (params.lanes) {
+                    smartLED_updateParallelTransfer(&parallel, IRQ);
+                } else {
+                    smartLED_updateTransfer(&strips[0], IRQ);
+                }
+                IRQs++;
+
+                /* Each LED block of the refilled half is ready once the IRQ has encoded it */
+                for (uint32_t ii = 0; ii < half; ii++) {
+                    readyAt[refillStart + ii] = t + params.IRQNs + params.encodeNs * lanesNum * (ii / blockLen + 1u);
+                }
+                pos %= len;
+            }
+        }
+        if (*running) {
+            break;
+        }
+
+        /* Check the frame of each update on its own, the line stays idle until the next one starts */
+        if (transfer < params.updates) {
+            gapNs = dec[0].idleRun * SIM_BIT_NS;
+            stopIdle = (dec[0].idleRun < stopIdle) ? dec[0].idleRun : stopIdle;
+            sim_frameEnd(&dec[0]);
+            dec[0].started = 0;
+            dec[0].idleRun = 0;
+        }
+    }
+    /* A transfer stopped early leaves the line low after the last frame */
+    leftLow = SIM_TIMED_RESET && !params.streaming && (params.dmaMode == SMARTLED_DMA_CIRCULAR);
+    for (uint8_t ll = 0; ll < lanesNum; ll++) {
+        double laneResetNs = dec[ll].idleRun * SIM_BIT_NS;
+
+        if (dec[ll].started) {
+            sim_frameEnd(&dec[ll]);
+        }
+        if (!leftLow && ((resetNs < 0) || (laneResetNs < resetNs))) {
+            resetNs = laneResetNs;
+        }
+        stopIdle = (dec[ll].idleRun < stopIdle) ? dec[ll].idleRun : stopIdle;
+        frames += dec[ll].frames;
+        badFrames += dec[ll].badFrames;
+        invalid += dec[ll].invalid;
+        gaps += dec[ll].gaps;
+        if (dec[ll].frames != (params.streaming ? params.frames : (1u + params.updates))) {
+            ret = 1;
+        }
+    }
+
+    printf("transfer: %.1f us, %u IRQs, %u frames decoded, %u wrong, %u invalid pulses, %u short gaps\n", t / 1000.0, IRQs, frames, badFrames,
+           invalid, gaps);
+    if (params.streaming && (dec[0].frames > 1)) {
+        double periodNs = (dec[0].frameStart - dec[0].firstFrameStart) / (dec[0].frames - 1u);
+
+        printf("frame period: %.1f us (%.1f Hz), shortest reset gap between frames: %.1f us\n", periodNs / 1000.0, 1e9 / periodNs,
+               dec[0].minGap * SIM_BIT_NS / 1000.0);
+    }
+    if (leftLow) {
+        if (resetNs >= 0) {
+            printf("shortest reset gap between transfers: %.1f us (%.1f us required), ", resetNs / 1000.0, sim_resetNs(params.chip) / 1000.0);
+        }
+        printf("line left low after the DMA stop, %u LED blocks after the last frame\n",
+               (uint32_t)(dec[0].idleRun / ((uint32_t)strips[0]._LEDBits)));
+        /* The last bit is only known to be out once an empty LED block followed it */
+        if (stopIdle < strips[0]._LEDBits) {
+            printf("DMA stopped before an empty LED block followed the data\n");
+            ret = 1;
+        }
+    } else {
+        printf("reset gap after last frame: %.1f us (%.1f us required)\n", resetNs / 1000.0, sim_resetNs(params.chip) / 1000.0);
+    }
+    printf("overruns: %u\n", overruns);
+
+    if (*running) {
+        printf("transfer did not stop\n");
+        ret = 1;
+    }
+    if (params.lanes && htim.stubChannelsOn) {
+        printf("channels left enabled: 0x%X\n", htim.stubChannelsOn);
+        ret = 1;
+    }
+    if (params.adalight) {
+        /* Stream ends with the colors of the last frame */
+        sim_adaPos += smartLED_parseAdalight(&ada, &sim_adaStream[sim_adaPos], sim_adaLength - sim_adaPos);
+        printf("Adalight: %u frames presented, %u headers with wrong checksum, %u of %u bytes consumed\n", smartLED_getAdalightFrames(&ada),
+               smartLED_getAdalightErrors(&ada), sim_adaPos, sim_adaLength);
+        if ((smartLED_getAdalightFrames(&ada) != params.frames) || (smartLED_getAdalightErrors(&ada) != sim_adaBadHeaders) || (sim_adaPos != sim_adaLength)) {
+            ret = 1;
+        }
+    }
+    if (params.fade && smartLED_isFading(&strips[0])) {
+        printf("crossfade did not complete\n");
+        ret = 1;
+    }
+    if (overruns || badFrames || invalid || gaps || ((resetNs >= 0) && (resetNs < sim_resetNs(params.chip))) || ((resetNs < 0) && !leftLow)) {
+        ret = 1;
+    }
+#ifdef SMARTLED_USE_STATS
+    /* IRQs are paced to the host clock, but refills may still be late on a loaded host, a full frame buffer is never refilled */
+    if (!params.lanes) {
+        smartLEDStats_t stats;
+
+        smartLED_getStats(&strips[0], &stats);
+        printf("driver stats: %u frames, %u IRQs in the last one, %u late refills\n", stats.framesCompleted, stats.IRQCount, stats.lateRefills);
+        if ((params.dmaMode == SMARTLED_DMA_FULLFRAME) && stats.lateRefills) {
+            printf("late refills reported without refills\n");
+            ret = 1;
+        }
+    }
+#endif /* SMARTLED_USE_STATS */
+
+    for (uint8_t ll = 0; ll < lanesNum; ll++) {
+        free(colors[ll]);
+        free(expected[ll]);
+        free(dec[ll].bytes);
+#ifdef SMARTLED_USE_DITHERING
+        free(sim_error[ll]);
+#endif /* SMARTLED_USE_DITHERING */
+    }
+    free(frontColors);
+    free(frontExpected);
+    free(sim_fadeTo);
+    free(sim_adaStream);
+    free(sim_adaData);
+    free(sim_adaLEDs);
+    free(sim_blended);
+    free(stale);
+    free(readyAt);
+    return ret;
+}
@@ -0,0 +1,149 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            hal_stub.c
+ * \author          Andrea Vivani
+ * \brief           Host stub of the HAL timer and SPI functions used by smartLED
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Includes ------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "tim.h"
+#include "spi.h"
+
+/* Variables -----------------------------------------------------------------*/
+
+uint32_t SystemCoreClock = 1000000000u;
+static DWT_Type stub_DWT;
+
+/* Private Functions ---------------------------------------------------------*/
+
+static HAL_StatusTypeDef stub_start(TIM_HandleTypeDef* htim, uint32_t Channel, const uint32_t* pData, uint16_t Length, uint8_t complementary) {
+    if ((htim == NULL) || (pData == NULL) || (Length == 0) || htim->stubRunning) {
+        return HAL_ERROR;
+    }
+    htim->stubBuffer = (uint32_t*)pData;
+    htim->stubLength = Length;
+    htim->stubChannel = Channel;
+    htim->stubComplementary = complementary;
+    htim->stubRunning = 1;
+    htim->stubStartCount++;
+    htim->stubStartCycles = HAL_stubDWT()->CYCCNT;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef stub_stop(TIM_HandleTypeDef* htim, uint32_t Channel) {
+    if ((htim == NULL) || !htim->stubRunning || (htim->stubChannel != Channel)) {
+        return HAL_ERROR;
+    }
+    htim->stubRunning = 0;
+    htim->stubStopCount++;
+    htim->stubStopCycles = HAL_stubDWT()->CYCCNT;
+    return HAL_OK;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef* htim, uint32_t Channel, const uint32_t* pData, uint16_t Length) {
+    return stub_start(htim, Channel, pData, Length, 0);
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef* htim, uint32_t Channel) { return stub_stop(htim, Channel); }
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start_DMA(TIM_HandleTypeDef* htim, uint32_t Channel, const uint32_t* pData, uint16_t Length) {
+    return stub_start(htim, Channel, pData, Length, 1);
+}
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop_DMA(TIM_HandleTypeDef* htim, uint32_t Channel) { return stub_stop(htim, Channel); }
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef* htim, uint32_t Channel) {
+    htim->stubChannelsOn |= (uint8_t)(1u << (Channel >> 2));
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef* htim, uint32_t Channel) {
+    htim->stubChannelsOn &= (uint8_t)~(1u << (Channel >> 2));
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start(TIM_HandleTypeDef* htim, uint32_t Channel) { return HAL_TIM_PWM_Start(htim, Channel); }
+
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop(TIM_HandleTypeDef* htim, uint32_t Channel) { return HAL_TIM_PWM_Stop(htim, Channel); }
+
+HAL_StatusTypeDef HAL_TIM_DMABurst_MultiWriteStart(TIM_HandleTypeDef* htim, uint32_t BurstBaseAddress, uint32_t BurstRequestSrc, const uint32_t* BurstBuffer,
+                                                   uint32_t BurstLength, uint32_t DataLength) {
+    if ((BurstBaseAddress != TIM_DMABASE_CCR1) || (BurstRequestSrc != TIM_DMA_UPDATE) || (DataLength > 0xFFFFu)) {
+        return HAL_ERROR;
+    }
+    htim->stubBurstLength = BurstLength;
+    return stub_start(htim, TIM_DMA_UPDATE, BurstBuffer, (uint16_t)DataLength, 0);
+}
+
+HAL_StatusTypeDef HAL_TIM_DMABurst_WriteStop(TIM_HandleTypeDef* htim, uint32_t BurstRequestSrc) { return stub_stop(htim, BurstRequestSrc); }
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size) {
+    if ((hspi == NULL) || (pData == NULL) || (Size == 0) || hspi->stubRunning) {
+        return HAL_ERROR;
+    }
+    hspi->stubBuffer = pData;
+    hspi->stubLength = Size;
+    hspi->stubRunning = 1;
+    hspi->stubStartCount++;
+    hspi->stubStartCycles = HAL_stubDWT()->CYCCNT;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef* hspi) {
+    if ((hspi == NULL) || !hspi->stubRunning) {
+        return HAL_ERROR;
+    }
+    hspi->stubRunning = 0;
+    hspi->stubStopCount++;
+    hspi->stubStopCycles = HAL_stubDWT()->CYCCNT;
+    return HAL_OK;
+}
+
+void HAL_Delay(uint32_t Delay) {
+    struct timespec ts = {.tv_sec = Delay / 1000u, .tv_nsec = (long)(Delay % 1000u) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+uint32_t HAL_GetTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000L);
+}
+
+DWT_Type* HAL_stubDWT(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stub_DWT.CYCCNT = (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+    return &stub_DWT;
+}
@@ -0,0 +1,74 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            spi.h
+ * \author          Andrea Vivani
+ * \brief           Host stub of the CubeMX SPI header, used to build smartLED
+ *                  without a target board
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPI_H__
+#define __SPI_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include "tim.h"
+
+/* Typedefs ------------------------------------------------------------------*/
+
+/**
+ * SPI handle
+ */
+typedef struct {
+    DMA_HandleTypeDef* hdmatx;
+    /* Stub state */
+    uint8_t* stubBuffer;     // buffer passed to the last DMA transmit
+    uint16_t stubLength;     // length passed to the last DMA transmit
+    uint8_t stubRunning;     // 1 between a DMA transmit and the matching stop
+    uint32_t stubStartCount; // number of DMA transmits
+    uint32_t stubStartCycles; // DWT cycle count at the last DMA transmit
+    uint32_t stubStopCount;  // number of DMA stops
+    uint32_t stubStopCycles; // DWT cycle count at the last DMA stop
+} SPI_HandleTypeDef;
+
+/* Function prototypes -------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef* hspi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPI_H__ */
@@ -0,0 +1,151 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            tim.h
+ * \author          Andrea Vivani
+ * \brief           Host stub of the CubeMX timer header, used to build smartLED
+ *                  without a target board
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TIM_H__
+#define __TIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/* Macros --------------------------------------------------------------------*/
+
+#define TIM_CHANNEL_1 0x00000000U
+#define TIM_CHANNEL_2 0x00000004U
+#define TIM_CHANNEL_3 0x00000008U
+#define TIM_CHANNEL_4 0x0000000CU
+
+#define TIM_DMA_ID_CC1                0x0001U
+#define DMA_IT_HT                     0x00000008U
+
+#define TIM_DMABASE_CCR1              0x0000000DU
+#define TIM_DMA_UPDATE                0x00000100U
+#define TIM_DMABURSTLENGTH_1TRANSFER  0x00000000U
+#define TIM_DMABURSTLENGTH_2TRANSFERS 0x00000100U
+#define TIM_DMABURSTLENGTH_3TRANSFERS 0x00000200U
+#define TIM_DMABURSTLENGTH_4TRANSFERS 0x00000300U
+
+#define __HAL_DMA_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->stubDisabledIT |= (__INTERRUPT__))
+
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__)                                                                                            \
+    (*(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+
+/* Cycle counter, emulated with the host monotonic clock (1 cycle = 1 ns) */
+#define DWT           (HAL_stubDWT())
+
+/* Typedefs ------------------------------------------------------------------*/
+
+/**
+ * HAL return status
+ */
+typedef enum { HAL_OK = 0x00U, HAL_ERROR = 0x01U, HAL_BUSY = 0x02U, HAL_TIMEOUT = 0x03U } HAL_StatusTypeDef;
+
+/**
+ * DMA handle
+ */
+typedef struct {
+    uint32_t stubDisabledIT; // interrupts disabled with __HAL_DMA_DISABLE_IT()
+} DMA_HandleTypeDef;
+
+/**
+ * Timer registers
+ */
+typedef struct {
+    volatile uint32_t CNT;
+    volatile uint32_t ARR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+} TIM_TypeDef;
+
+/**
+ * Timer handle
+ */
+typedef struct {
+    TIM_TypeDef* Instance;
+    DMA_HandleTypeDef* hdma[7];
+    /* Stub state */
+    uint32_t* stubBuffer;    // buffer passed to the last PWM DMA start
+    uint16_t stubLength;     // length passed to the last PWM DMA start
+    uint32_t stubChannel;    // channel passed to the last PWM DMA start
+    uint8_t stubComplementary; // 1 if the last start used the complementary output
+    uint8_t stubRunning;     // 1 between a PWM DMA start and the matching stop
+    uint32_t stubStartCount; // number of PWM DMA starts
+    uint32_t stubStartCycles; // DWT cycle count at the last PWM DMA start
+    uint32_t stubStopCount;  // number of PWM DMA stops
+    uint32_t stubStopCycles; // DWT cycle count at the last PWM DMA stop
+    uint32_t stubBurstLength; // burst length passed to the last DMA burst start
+    uint8_t stubChannelsOn;  // bit n set while channel n + 1 output is enabled without DMA
+} TIM_HandleTypeDef;
+
+/**
+ * Data watchpoint and trace registers
+ */
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+/* Variables -----------------------------------------------------------------*/
+
+extern uint32_t SystemCoreClock;
+
+/* Function prototypes -------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start_DMA(TIM_HandleTypeDef* htim, uint32_t Channel, const uint32_t* pData, uint16_t Length);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop_DMA(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start_DMA(TIM_HandleTypeDef* htim, uint32_t Channel, const uint32_t* pData, uint16_t Length);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop_DMA(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Stop(TIM_HandleTypeDef* htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_DMABurst_MultiWriteStart(TIM_HandleTypeDef* htim, uint32_t BurstBaseAddress, uint32_t BurstRequestSrc, const uint32_t* BurstBuffer,
+                                                   uint32_t BurstLength, uint32_t DataLength);
+HAL_StatusTypeDef HAL_TIM_DMABurst_WriteStop(TIM_HandleTypeDef* htim, uint32_t BurstRequestSrc);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+DWT_Type* HAL_stubDWT(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIM_H__ */
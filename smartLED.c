@@ -39,78 +39,1025 @@
 
 /* Macros --------------------------------------------------------------------*/
 
-/* PWM frequency in kHz */
-#ifndef SMARTLED_PWM_FREQ
-#define SMARTLED_PWM_FREQ 800
-#endif /* SMARTLED_PWM_FREQ */
+/* LEDs encoded by each round of the smartLED_initAutoTune() measurement, and number of rounds */
+#define SMARTLED_TUNE_LEDS   16u
+#define SMARTLED_TUNE_ROUNDS 4u
+
+/* Pulse mask lookup table -------------------------------------------------*/
+#ifdef SMARTLED_USE_LUT
+/* Each entry expands one color byte into 8 pulse slots (MSB first), stored as two little-endian words
+ * where every slot is 0xFF for a `1` bit and 0x00 for a `0` bit */
+#define SMARTLED_BIT_MASK(b, n) ((((b) >> (n)) & 1u) ? 0xFFu : 0x00u)
+#define SMARTLED_MASK_ROW(b)                                                                                                                                   \
+    {SMARTLED_BIT_MASK(b, 7) | (SMARTLED_BIT_MASK(b, 6) << 8) | (SMARTLED_BIT_MASK(b, 5) << 16) | ((uint32_t)SMARTLED_BIT_MASK(b, 4) << 24),                 \
+     SMARTLED_BIT_MASK(b, 3) | (SMARTLED_BIT_MASK(b, 2) << 8) | (SMARTLED_BIT_MASK(b, 1) << 16) | ((uint32_t)SMARTLED_BIT_MASK(b, 0) << 24)}
+#define SMARTLED_MASK_ROW4(b)  SMARTLED_MASK_ROW(b), SMARTLED_MASK_ROW((b) + 1), SMARTLED_MASK_ROW((b) + 2), SMARTLED_MASK_ROW((b) + 3)
+#define SMARTLED_MASK_ROW16(b) SMARTLED_MASK_ROW4(b), SMARTLED_MASK_ROW4((b) + 4), SMARTLED_MASK_ROW4((b) + 8), SMARTLED_MASK_ROW4((b) + 12)
+#define SMARTLED_MASK_ROW64(b) SMARTLED_MASK_ROW16(b), SMARTLED_MASK_ROW16((b) + 16), SMARTLED_MASK_ROW16((b) + 32), SMARTLED_MASK_ROW16((b) + 48)
+
+static const uint32_t smartLED_pulseMaskLUT[256][2] = {SMARTLED_MASK_ROW64(0), SMARTLED_MASK_ROW64(64), SMARTLED_MASK_ROW64(128), SMARTLED_MASK_ROW64(192)};
+#endif /* SMARTLED_USE_LUT */
+
+/* SPI symbol tables ---------------------------------------------------------*/
+#ifdef SMARTLED_USE_SPI
+/* Symbols of one nibble, MSB first: `1` is sent as 110, `0` as 100 */
+static const uint16_t smartLED_SPI3Nibble[16] = {0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+                                                 0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6};
+
+/* Symbols of one nibble, MSB first: `1` is sent as 1110, `0` as 1000 */
+static const uint16_t smartLED_SPI4Nibble[16] = {0x8888, 0x888E, 0x88E8, 0x88EE, 0x8E88, 0x8E8E, 0x8EE8, 0x8EEE,
+                                                 0xE888, 0xE88E, 0xE8E8, 0xE8EE, 0xEE88, 0xEE8E, 0xEEE8, 0xEEEE};
+
+#define SMARTLED_IS_PWM(smartled) ((smartled)->output == SMARTLED_OUTPUT_PWM)
+#else
+#define SMARTLED_IS_PWM(smartled) 1
+#endif /* SMARTLED_USE_SPI */
+
+/* Gamma table ---------------------------------------------------------------*/
+#ifdef SMARTLED_USE_GAMMA
+/* 255 * (value / 255) ^ 2.6 in 8.8 fixed point */
+static const uint16_t smartLED_gamma[256] = {
+    0x0000, 0x0000, 0x0000, 0x0001, 0x0001, 0x0002, 0x0004, 0x0006, 0x0008, 0x000B, 0x000E, 0x0012, 0x0017, 0x001C, 0x0022, 0x0029,
+    0x0031, 0x0039, 0x0042, 0x004C, 0x0057, 0x0063, 0x0070, 0x007D, 0x008C, 0x009C, 0x00AC, 0x00BE, 0x00D1, 0x00E5, 0x00FA, 0x0110,
+    0x0128, 0x0141, 0x015A, 0x0176, 0x0192, 0x01B0, 0x01CF, 0x01EF, 0x0211, 0x0234, 0x0258, 0x027E, 0x02A5, 0x02CE, 0x02F8, 0x0324,
+    0x0351, 0x0380, 0x03B0, 0x03E2, 0x0416, 0x044B, 0x0481, 0x04BA, 0x04F4, 0x0530, 0x056D, 0x05AC, 0x05ED, 0x0630, 0x0674, 0x06BA,
+    0x0702, 0x074C, 0x0798, 0x07E5, 0x0834, 0x0886, 0x08D9, 0x092E, 0x0985, 0x09DE, 0x0A39, 0x0A96, 0x0AF5, 0x0B56, 0x0BB9, 0x0C1E,
+    0x0C85, 0x0CEE, 0x0D59, 0x0DC7, 0x0E36, 0x0EA8, 0x0F1C, 0x0F92, 0x100A, 0x1085, 0x1101, 0x1180, 0x1201, 0x1285, 0x130A, 0x1392,
+    0x141D, 0x14A9, 0x1538, 0x15C9, 0x165D, 0x16F3, 0x178B, 0x1826, 0x18C4, 0x1963, 0x1A05, 0x1AAA, 0x1B51, 0x1BFB, 0x1CA7, 0x1D56,
+    0x1E07, 0x1EBA, 0x1F71, 0x202A, 0x20E5, 0x21A3, 0x2264, 0x2327, 0x23ED, 0x24B6, 0x2581, 0x264F, 0x271F, 0x27F3, 0x28C9, 0x29A2,
+    0x2A7D, 0x2B5C, 0x2C3D, 0x2D21, 0x2E07, 0x2EF1, 0x2FDD, 0x30CC, 0x31BE, 0x32B3, 0x33AB, 0x34A6, 0x35A3, 0x36A4, 0x37A7, 0x38AD,
+    0x39B7, 0x3AC3, 0x3BD2, 0x3CE4, 0x3DFA, 0x3F12, 0x402D, 0x414B, 0x426D, 0x4391, 0x44B9, 0x45E3, 0x4711, 0x4842, 0x4975, 0x4AAC,
+    0x4BE7, 0x4D24, 0x4E64, 0x4FA8, 0x50EF, 0x5239, 0x5386, 0x54D7, 0x562B, 0x5782, 0x58DC, 0x5A3A, 0x5B9A, 0x5CFE, 0x5E66, 0x5FD1,
+    0x613F, 0x62B0, 0x6425, 0x659D, 0x6719, 0x6898, 0x6A1A, 0x6BA0, 0x6D29, 0x6EB5, 0x7045, 0x71D9, 0x7370, 0x750A, 0x76A8, 0x784A,
+    0x79EF, 0x7B97, 0x7D43, 0x7EF3, 0x80A6, 0x825C, 0x8417, 0x85D4, 0x8796, 0x895B, 0x8B24, 0x8CF0, 0x8EC0, 0x9093, 0x926B, 0x9446,
+    0x9624, 0x9806, 0x99ED, 0x9BD6, 0x9DC4, 0x9FB5, 0xA1AA, 0xA3A3, 0xA59F, 0xA79F, 0xA9A3, 0xABAB, 0xADB7, 0xAFC6, 0xB1DA, 0xB3F1,
+    0xB60C, 0xB82B, 0xBA4D, 0xBC74, 0xBE9E, 0xC0CD, 0xC2FF, 0xC536, 0xC770, 0xC9AE, 0xCBF0, 0xCE36, 0xD080, 0xD2CE, 0xD520, 0xD776,
+    0xD9D0, 0xDC2E, 0xDE90, 0xE0F7, 0xE361, 0xE5CF, 0xE842, 0xEAB8, 0xED33, 0xEFB1, 0xF234, 0xF4BB, 0xF746, 0xF9D5, 0xFC68, 0xFF00,
+};
+#endif /* SMARTLED_USE_GAMMA */
+
+/* Color order tables --------------------------------------------------------*/
+
+/* Wire position of red, green and blue for each smartLEDColorOrder_t */
+static const uint8_t smartLED_colorOffsets[6][3] = {
+    {1, 0, 2}, // GRB
+    {0, 1, 2}, // RGB
+    {1, 2, 0}, // BRG
+    {0, 2, 1}, // RBG
+    {2, 0, 1}, // GBR
+    {2, 1, 0}, // BGR
+};
 
 /* Private Functions ---------------------------------------------------------*/
+#ifdef SMARTLED_USE_LUT
+static void smartLED_buildLUT(smartLED_t* smartled) {
+    for (uint32_t ii = 0; ii < 256u; ii++) {
+        smartled->_brightnessLUT[ii] = (uint8_t)((ii * (uint32_t)smartled->_brightness) / (uint32_t)0xFF);
+    }
+    smartled->_LUTBrightness = smartled->_brightness;
+}
+
+#endif /* SMARTLED_USE_LUT */
+
+#ifdef SMARTLED_USE_COLOR_TABLE
+static void smartLED_buildColorTable(smartLED_t* smartled) {
+    for (uint32_t ii = 0; ii < 256u; ii++) {
+#ifdef SMARTLED_USE_GAMMA
+        uint32_t value = smartLED_gamma[ii];
+#else
+        uint32_t value = ii << 8;
+#endif /* SMARTLED_USE_GAMMA */
+        smartled->_colorTable[ii] = (uint16_t)((value * smartled->_brightness) / (uint32_t)0xFF);
+    }
+    smartled->_colorTableBrightness = smartled->_brightness;
+}
+#endif /* SMARTLED_USE_COLOR_TABLE */
+
+#ifdef SMARTLED_USE_DITHERING
+/* Dithering error follows the colors of the LED data array, starting from half a step so that the first frame is rounded */
+static void smartLED_setDitherError(smartLED_t* smartled) {
+    if ((smartled->palette != SMARTLED_PALETTE_NONE) || (smartled->_txData == NULL)) {
+        smartled->_ditherError = NULL;
+        return;
+    }
+    smartled->_ditherError = &smartled->_txData[(uint32_t)smartled->type * smartled->size];
+    memset(smartled->_ditherError, 0x80, sizeof(uint8_t) * smartled->type * smartled->size);
+}
+#endif /* SMARTLED_USE_DITHERING */
+
+static inline uint8_t smartLED_scale(const smartLED_t* smartled, uint8_t value) {
+#if defined(SMARTLED_USE_COLOR_TABLE)
+    return (uint8_t)((smartled->_colorTable[value] + 0x80u) >> 8);
+#elif defined(SMARTLED_USE_LUT)
+    return smartled->_brightnessLUT[value];
+#else
+    return (uint8_t)(((uint32_t)value * (uint32_t)smartled->_brightness) / (uint32_t)0xFF);
+#endif /* SMARTLED_USE_LUT */
+}
+
+/* Encode one color byte at dst, return pointer to the next free byte */
+static inline uint8_t* smartLED_encodeByte(const smartLED_t* smartled, uint8_t* dst, uint8_t value) {
+#ifdef SMARTLED_USE_SPI
+    if (smartled->output == SMARTLED_OUTPUT_SPI_3BIT) {
+        uint32_t symbols = ((uint32_t)smartLED_SPI3Nibble[value >> 4] << 12) | smartLED_SPI3Nibble[value & 0x0F];
+
+        dst[0] = (uint8_t)(symbols >> 16);
+        dst[1] = (uint8_t)(symbols >> 8);
+        dst[2] = (uint8_t)symbols;
+        return dst + 3;
+    }
+    if (smartled->output == SMARTLED_OUTPUT_SPI_4BIT) {
+        dst[0] = (uint8_t)(smartLED_SPI4Nibble[value >> 4] >> 8);
+        dst[1] = (uint8_t)smartLED_SPI4Nibble[value >> 4];
+        dst[2] = (uint8_t)(smartLED_SPI4Nibble[value & 0x0F] >> 8);
+        dst[3] = (uint8_t)smartLED_SPI4Nibble[value & 0x0F];
+        return dst + 4;
+    }
+#endif /* SMARTLED_USE_SPI */
+
+#ifdef SMARTLED_USE_LUT
+    /* Select _pulseHigh where the mask is set and _pulseLow elsewhere, 4 slots per store */
+    uint32_t w0 = smartled->_pulseLowWord ^ (smartled->_pulseXorWord & smartLED_pulseMaskLUT[value][0]);
+    uint32_t w1 = smartled->_pulseLowWord ^ (smartled->_pulseXorWord & smartLED_pulseMaskLUT[value][1]);
+
+    memcpy(dst, &w0, sizeof(uint32_t));
+    memcpy(dst + 4, &w1, sizeof(uint32_t));
+#else
+    for (uint32_t ii = 0; ii < 8u; ii++) {
+        dst[ii] = (value & (0x80u >> ii)) ? smartled->_pulseHigh : smartled->_pulseLow;
+    }
+#endif /* SMARTLED_USE_LUT */
+    return dst + 8;
+}
+
+#ifdef SMARTLED_USE_STATS
+static void smartLED_statsFrameStart(smartLED_t* smartled, uint32_t now) {
+    smartled->_statsFrameStart = now;
+    smartled->_statsIRQMin = UINT32_MAX;
+    smartled->_statsIRQMax = 0;
+    smartled->_statsIRQSum = 0;
+    smartled->_statsIRQCount = 0;
+}
+
+static void smartLED_statsIRQ(smartLED_t* smartled, uint32_t IRQStart, uint8_t frameDone) {
+    uint32_t now = SMARTLED_GET_CYCLES();
+    uint32_t duration = now - IRQStart;
+
+    if (duration < smartled->_statsIRQMin) {
+        smartled->_statsIRQMin = duration;
+    }
+    if (duration > smartled->_statsIRQMax) {
+        smartled->_statsIRQMax = duration;
+    }
+    smartled->_statsIRQSum += duration;
+
+    /* Each IRQ fires one half buffer after the previous one and must complete the refill before the DMA wraps back to it
+     * A full frame buffer is never refilled, its only IRQ fires at the end of the frame */
+    if (smartled->dmaMode != SMARTLED_DMA_FULLFRAME) {
+        if ((int32_t)(now - smartled->_statsDeadline) > 0) {
+            smartled->_stats.lateRefills++;
+        }
+        smartled->_statsDeadline += smartled->_statsHalfCycles;
+    }
+    smartled->_statsIRQCount++;
+
+    /* Publish frame statistics */
+    if (frameDone) {
+        smartled->_stats.IRQCyclesMin = smartled->_statsIRQMin;
+        smartled->_stats.IRQCyclesMax = smartled->_statsIRQMax;
+        smartled->_stats.IRQCyclesAvg = smartled->_statsIRQSum / smartled->_statsIRQCount;
+        smartled->_stats.IRQCount = smartled->_statsIRQCount;
+        smartled->_stats.frameCycles = now - smartled->_statsFrameStart;
+        smartled->_stats.framesCompleted++;
+        smartLED_statsFrameStart(smartled, now);
+    }
+}
+#endif /* SMARTLED_USE_STATS */
+
 static smartLED_retStatus_t smartLED_fillDMABuffer(smartLED_t* smartled, uint16_t item, uint32_t startingIdx) {
-    if (item >= smartled->size) {
+    if (item >= smartled->_frameSize) {
+        return SMARTLED_ERROR;
+    }
+
+    const uint8_t* color;
+    uint8_t shaded[4];
+    uint8_t* dst = &smartled->_dmaBuffer[startingIdx];
+
+    /* Palette entries are stored in wire order and already scaled by brightness */
+    if (smartled->palette != SMARTLED_PALETTE_NONE) {
+        const uint8_t* indices = &smartled->_txData[smartled->_indexOffset];
+        uint8_t index = (smartled->palette == SMARTLED_PALETTE_4BIT) ? ((indices[item >> 1] >> ((item & 1u) << 2)) & 0x0F) : indices[item];
+
+        color = &smartled->_txData[((1u << smartled->palette) + index) * smartled->type];
+        for (uint8_t ii = 0; ii < smartled->type; ii++) {
+            dst = smartLED_encodeByte(smartled, dst, color[ii]);
+        }
+        return SMARTLED_SUCCESS;
+    }
+
+    /* Pixel shader renders the LED just in time, in place of the LED data array */
+    if (smartled->_shader != NULL) {
+        uint32_t value = smartled->_shader(item, smartled->_frameCounter);
+
+        shaded[smartled->_colorOffset[SMARTLED_RED]] = (uint8_t)(value >> 16);
+        shaded[smartled->_colorOffset[SMARTLED_GREEN]] = (uint8_t)(value >> 8);
+        shaded[smartled->_colorOffset[SMARTLED_BLUE]] = (uint8_t)value;
+        shaded[smartled->_colorOffset[SMARTLED_WHITE]] = (uint8_t)(value >> 24);
+        color = shaded;
+    } else if (smartled->_fadeFrames) {
+        /* Crossfade, blend front buffer into back buffer */
+        const uint8_t* from = &smartled->_txData[item * smartled->type];
+        const uint8_t* to = &smartled->_colorsData[item * smartled->type];
+        uint32_t blend = smartled->_fadeBlend;
+
+        for (uint8_t ii = 0; ii < smartled->type; ii++) {
+            shaded[ii] = (uint8_t)((from[ii] * (256u - blend) + to[ii] * blend) >> 8);
+        }
+        color = shaded;
+    } else {
+        color = &smartled->_txData[item * smartled->type];
+    }
+
+#ifdef SMARTLED_USE_DITHERING
+    /* Send the integer part of each color and carry its fraction over to the next frame */
+    if (smartled->_ditherError != NULL) {
+        uint8_t* error = &smartled->_ditherError[item * smartled->type];
+
+        for (uint8_t ii = 0; ii < smartled->type; ii++) {
+            uint32_t value = (uint32_t)smartled->_colorTable[color[ii]] + error[ii];
+
+            error[ii] = (uint8_t)value;
+            dst = smartLED_encodeByte(smartled, dst, (uint8_t)(value >> 8));
+        }
+        return SMARTLED_SUCCESS;
+    }
+#endif /* SMARTLED_USE_DITHERING */
+
+    /* LED data is stored in wire order */
+    for (uint8_t ii = 0; ii < smartled->type; ii++) {
+        dst = smartLED_encodeByte(smartled, dst, smartLED_scale(smartled, color[ii]));
+    }
+    return SMARTLED_SUCCESS;
+}
+
+/* Encoder specialized by SMARTLED_DEFINE_STATIC, only for colors sent as they are stored */
+static inline uint8_t smartLED_useEncodeBlock(const smartLED_t* smartled) {
+    if ((smartled->_encodeBlock == NULL) || (smartled->_shader != NULL) || smartled->_fadeFrames || !SMARTLED_IS_PWM(smartled)) {
+        return 0;
+    }
+#ifdef SMARTLED_USE_DITHERING
+    if (smartled->_ditherError != NULL) {
+        return 0;
+    }
+#endif /* SMARTLED_USE_DITHERING */
+    return 1;
+}
+
+/* Rebuild brightness dependent tables before a frame is encoded */
+static void smartLED_prepareFrame(smartLED_t* smartled) {
+#ifdef SMARTLED_USE_LUT
+    /* Brightness changed since last transfer */
+    if (smartled->_LUTBrightness != smartled->_brightness) {
+        smartLED_buildLUT(smartled);
+    }
+#endif /* SMARTLED_USE_LUT */
+#ifdef SMARTLED_USE_COLOR_TABLE
+    if (smartled->_colorTableBrightness != smartled->_brightness) {
+        smartLED_buildColorTable(smartled);
+    }
+#endif /* SMARTLED_USE_COLOR_TABLE */
+
+    /* Scaled palette follows raw palette in the LED data array being sent */
+    if ((smartled->palette != SMARTLED_PALETTE_NONE) && (smartled->_paletteDirty || (smartled->_paletteBrightness != smartled->_brightness))) {
+        uint32_t paletteLen = (1u << smartled->palette) * smartled->type;
+
+        for (uint32_t ii = 0; ii < paletteLen; ii++) {
+            smartled->_txData[paletteLen + ii] = smartLED_scale(smartled, smartled->_txData[ii]);
+        }
+        smartled->_paletteBrightness = smartled->_brightness;
+        smartled->_paletteDirty = 0;
+    }
+}
+
+/* Advance the crossfade by one frame, the back buffer becomes the front one at the last step
+ * Fades are sent whole, as any transfer of a double buffer, so the changed LEDs are only tracked again once the fade is complete */
+static void smartLED_fadeStep(smartLED_t* smartled) {
+    if (!smartled->_fadeFrames) {
+        return;
+    }
+
+    if (++smartled->_fadeFrame < smartled->_fadeFrames) {
+        smartled->_fadeBlend = (uint16_t)(((uint32_t)smartled->_fadeFrame << 8) / smartled->_fadeFrames);
+        return;
+    }
+
+    uint8_t* front = smartled->_txData;
+
+    smartled->_txData = smartled->_colorsData;
+    smartled->_colorsData = front;
+    smartled->_fadeBlend = 0;
+    smartled->_fadeFrames = 0;
+
+    /* As after smartLED_present(), the new back buffer starts from the frame being sent and nothing is changed yet.
+     * While streaming, the ISR does not copy the strip: the back buffer keeps the starting frame, as it keeps the previous one after a present,
+     * and every frame is sent whole */
+    if (smartled->_streamState == SMARTLED_STREAM_OFF) {
+        memcpy(smartled->_colorsData, smartled->_txData,
+               sizeof(uint8_t)
+                   * (SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette)
+                      - SMARTLED_DITHER_SIZE(smartled->type, smartled->size, smartled->palette)));
+        smartled->_dirtyStart = smartled->size;
+        smartled->_dirtyEnd = 0;
+    }
+}
+
+/* Whole strip must be sent if brightness changed, colors are computed by a shader or dithered colors change at every frame */
+static uint8_t smartLED_wholeStrip(const smartLED_t* smartled) {
+    uint8_t wholeStrip = (smartled->_brightness != smartled->_sentBrightness) || (smartled->_shader != NULL);
+
+#ifdef SMARTLED_USE_DITHERING
+    wholeStrip |= (smartled->_ditherError != NULL);
+#endif /* SMARTLED_USE_DITHERING */
+    return wholeStrip;
+}
+
+/* Number of DMA buffer elements, two half buffers or the whole frame followed by the reset */
+static uint32_t smartLED_DMALength(const smartLED_t* smartled) {
+    if (smartled->dmaMode == SMARTLED_DMA_FULLFRAME) {
+        return ((uint32_t)smartled->size + smartled->_resetBlocks) * smartled->_LEDBytes;
+    }
+    return 2u * smartled->LEDperIRQ * smartled->_LEDBytes;
+}
+
+/* SMARTLED_GET_CYCLES() cycles needed to send the given number of LEDs of LEDBits bits */
+static uint32_t smartLED_blocksCycles(uint32_t LEDs, uint8_t LEDBits) {
+    return (uint32_t)(((uint64_t)SystemCoreClock * LEDs * LEDBits) / (SMARTLED_PWM_FREQ * 1000u));
+}
+
+/* SMARTLED_GET_CYCLES() cycles needed to send the given number of LEDs */
+static uint32_t smartLED_LEDsCycles(const smartLED_t* smartled, uint32_t LEDs) { return smartLED_blocksCycles(LEDs, smartled->_LEDBits); }
+
+/* Empty LED blocks sent after the last LED before DMA is stopped. With SMARTLED_USE_TIMED_RESET, DMA stops after the first one,
+ * once the last bit is out, and the rest of the reset is timed with the cycle counter */
+static uint32_t smartLED_stopBlocks(uint16_t resetBlocks) {
+#ifdef SMARTLED_USE_TIMED_RESET
+    return (resetBlocks != 0u);
+#else
+    return resetBlocks;
+#endif /* SMARTLED_USE_TIMED_RESET */
+}
+
+#ifdef SMARTLED_USE_TIMED_RESET
+/* Cycles the line must still stay low when DMA is stopped, sentBlocks empty LED blocks being already out */
+static uint32_t smartLED_latchCycles(uint16_t resetBlocks, uint32_t sentBlocks, uint8_t LEDBits) {
+    return (sentBlocks < resetBlocks) ? smartLED_blocksCycles(resetBlocks - sentBlocks, LEDBits) : 0;
+}
+
+/* Check if the reset started when DMA was stopped is still running */
+static uint8_t smartLED_latching(uint32_t latchStart, uint32_t* latchCycles) {
+    /* Cycle counter wraps around, the reset must not be checked again once elapsed */
+    if (*latchCycles && ((SMARTLED_GET_CYCLES() - latchStart) >= *latchCycles)) {
+        *latchCycles = 0;
+    }
+    return (*latchCycles != 0);
+}
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+static void smartLED_startDMA(smartLED_t* smartled) {
+    uint32_t length = smartLED_DMALength(smartled);
+    DMA_HandleTypeDef* hdma;
+
+#ifdef SMARTLED_USE_STATS
+    if (smartled->dmaMode != SMARTLED_DMA_FULLFRAME) {
+        smartled->_statsHalfCycles = smartLED_LEDsCycles(smartled, length / (2u * smartled->_LEDBytes));
+        smartled->_statsDeadline = SMARTLED_GET_CYCLES() + 2u * smartled->_statsHalfCycles;
+    }
+#endif /* SMARTLED_USE_STATS */
+
+#ifdef SMARTLED_USE_SPI
+    if (!SMARTLED_IS_PWM(smartled)) {
+        HAL_SPI_Transmit_DMA(smartled->hspi, smartled->_dmaBuffer, length);
+        hdma = smartled->hspi->hdmatx;
+    } else
+#endif /* SMARTLED_USE_SPI */
+    {
+        if (smartled->timType == SMARTLED_TIMER_NORMAL) {
+            HAL_TIM_PWM_Start_DMA(smartled->htim, smartled->timChannel, (uint32_t*)smartled->_dmaBuffer, length);
+        } else {
+            HAL_TIMEx_PWMN_Start_DMA(smartled->htim, smartled->timChannel, (uint32_t*)smartled->_dmaBuffer, length);
+        }
+        hdma = smartled->htim->hdma[TIM_DMA_ID_CC1 + (smartled->timChannel >> 2)];
+    }
+
+    /* A full frame only needs the transfer complete interrupt */
+    if ((smartled->dmaMode == SMARTLED_DMA_FULLFRAME) && (hdma != NULL)) {
+        __HAL_DMA_DISABLE_IT(hdma, DMA_IT_HT);
+    }
+}
+
+static void smartLED_stopDMA(smartLED_t* smartled) {
+#ifdef SMARTLED_USE_SPI
+    if (!SMARTLED_IS_PWM(smartled)) {
+        HAL_SPI_DMAStop(smartled->hspi);
+        return;
+    }
+#endif /* SMARTLED_USE_SPI */
+    if (smartled->timType == SMARTLED_TIMER_NORMAL) {
+        HAL_TIM_PWM_Stop_DMA(smartled->htim, smartled->timChannel);
+    } else {
+        HAL_TIMEx_PWMN_Stop_DMA(smartled->htim, smartled->timChannel);
+    }
+}
+
+static uint8_t smartLED_streamFill(smartLED_t* smartled, uint32_t startIdx) {
+    uint8_t frameDone = 0;
+
+    for (uint8_t counter = 0; counter < smartled->LEDperIRQ; counter++) {
+        uint32_t blockIdx = startIdx + counter * smartled->_LEDBytes;
+
+        /* Frame boundary: the reset gap of the previous frame is complete */
+        if (smartled->_streamPos == 0) {
+            if (smartled->_streamState == SMARTLED_STREAM_STOP_REQUESTED) {
+                memset(&(smartled->_dmaBuffer[blockIdx]), 0x00, sizeof(uint8_t) * (smartled->LEDperIRQ - counter) * smartled->_LEDBytes);
+                smartled->_streamState = SMARTLED_STREAM_FLUSHING;
+                return 1;
+            }
+
+            /* Pick up the last committed frame */
+            if (smartled->_pendingSwap) {
+                uint8_t* front = smartled->_txData;
+
+                smartled->_txData = smartled->_colorsData;
+                smartled->_colorsData = front;
+                smartled->_pendingSwap = 0;
+                smartled->_paletteDirty = 1;
+            }
+            smartLED_fadeStep(smartled);
+            smartLED_prepareFrame(smartled);
+            frameDone = 1;
+            if (smartled->_frameCallback != NULL) {
+                smartled->_frameCallback(smartled);
+            }
+        }
+
+        /* Whole remaining block within the LEDs, no frame boundary */
+        if ((counter == 0) && (smartled->_streamPos + smartled->LEDperIRQ <= smartled->size) && smartLED_useEncodeBlock(smartled)) {
+            smartled->_encodeBlock(smartled, (uint16_t)smartled->_streamPos, &(smartled->_dmaBuffer[blockIdx]));
+            smartled->_streamPos += smartled->LEDperIRQ;
+            return frameDone;
+        }
+
+        if (smartled->_streamPos < smartled->size) {
+            smartLED_fillDMABuffer(smartled, smartled->_streamPos, blockIdx);
+        } else {
+            memset(&(smartled->_dmaBuffer[blockIdx]), 0x00, sizeof(uint8_t) * smartled->_LEDBytes);
+        }
+        if (++smartled->_streamPos >= smartled->_streamFrameLEDs) {
+            smartled->_streamPos = 0;
+            smartled->_frameCounter++;
+        }
+    }
+    return frameDone;
+}
+
+static smartLED_retStatus_t smartLED_setup(smartLED_t* smartled) {
+    /* Check chip type */
+    if ((smartled->chip != WS2811) && (smartled->chip != WS2812B)) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Check led type */
+    if ((smartled->type != SMARTLED_RGB) && (smartled->type != SMARTLED_RGBW)) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Check number of LEDs */
+    if (smartled->size < 1) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Check DMA mode and number of LEDs per each IRQ */
+    if ((smartled->dmaMode != SMARTLED_DMA_CIRCULAR) && (smartled->dmaMode != SMARTLED_DMA_FULLFRAME)) {
+        return SMARTLED_ERROR;
+    }
+    if ((smartled->dmaMode == SMARTLED_DMA_CIRCULAR) && (smartled->LEDperIRQ < 1)) {
+        return SMARTLED_ERROR;
+    }
+
+    smartled->_brightness = 0xFF;
+    smartled->_sentBrightness = smartled->_brightness;
+    smartled->_dirtyStart = 0;
+    smartled->_dirtyEnd = smartled->size;
+    smartled->_LEDBits = smartled->type * 8;
+    smartled->_LEDBytes = smartled->_LEDBits;
+    smartled->_updating = 0;
+    smartled->_streamState = SMARTLED_STREAM_OFF;
+    smartled->_pendingSwap = 0;
+    smartled->_frameCallback = NULL;
+    smartled->_shader = NULL;
+    smartled->_encodeBlock = NULL;
+    smartled->_frameCounter = 0;
+    smartled->_fadeFrames = 0;
+    smartled->_fadeBlend = 0;
+
+    /* Check color order, colors are stored in wire order */
+    if ((uint32_t)smartled->colorOrder > SMARTLED_ORDER_BGR) {
+        return SMARTLED_ERROR;
+    }
+    smartled->_colorOffset[SMARTLED_RED] = smartLED_colorOffsets[smartled->colorOrder][0];
+    smartled->_colorOffset[SMARTLED_GREEN] = smartLED_colorOffsets[smartled->colorOrder][1];
+    smartled->_colorOffset[SMARTLED_BLUE] = smartLED_colorOffsets[smartled->colorOrder][2];
+    smartled->_colorOffset[SMARTLED_WHITE] = 3;
+
+    /* Check color mode, LED indices follow raw and scaled palette */
+    if ((smartled->palette != SMARTLED_PALETTE_NONE) && (smartled->palette != SMARTLED_PALETTE_4BIT) && (smartled->palette != SMARTLED_PALETTE_8BIT)) {
+        return SMARTLED_ERROR;
+    }
+    smartled->_indexOffset = (smartled->palette == SMARTLED_PALETTE_NONE) ? 0 : (uint16_t)((2u << smartled->palette) * smartled->type);
+    smartled->_paletteDirty = 1;
+
+#ifdef SMARTLED_USE_SPI
+    /* Check output */
+    if ((smartled->output != SMARTLED_OUTPUT_PWM) && (smartled->output != SMARTLED_OUTPUT_SPI_3BIT)
+        && (smartled->output != SMARTLED_OUTPUT_SPI_4BIT)) {
+        return SMARTLED_ERROR;
+    }
+
+    /* One SPI byte per symbol bit of each color */
+    if (!SMARTLED_IS_PWM(smartled)) {
+        if (smartled->hspi == NULL) {
+            return SMARTLED_ERROR;
+        }
+        smartled->_LEDBytes = smartled->type * smartled->output;
+    }
+#endif /* SMARTLED_USE_SPI */
+
+    if (SMARTLED_IS_PWM(smartled)) {
+        /* Check timer type */
+        if ((smartled->timType != SMARTLED_TIMER_NORMAL) && (smartled->timType != SMARTLED_TIMER_EXTENDED)) {
+            return SMARTLED_ERROR;
+        }
+
+        /* Check that timer has been configured */
+        if (!smartled->htim->Instance->ARR) {
+            return SMARTLED_ERROR;
+        }
+
+        smartled->_pulseLow = (uint8_t)((float)smartled->htim->Instance->ARR * 0.33f);
+        smartled->_pulseHigh = (uint8_t)((float)smartled->htim->Instance->ARR * 0.65f);
+    }
+
+    /* Set the right amount of empty LED blocks needed between two consecutive transfers */
+    smartled->_resetBlocks = SMARTLED_RESET_BLOCKS(smartled->chip, smartled->type);
+#ifdef SMARTLED_USE_TIMED_RESET
+    smartled->_latchCycles = 0;
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+    /* Check that the whole buffer fits a DMA transfer */
+    if (smartLED_DMALength(smartled) > 0xFFFFu) {
+        return SMARTLED_ERROR;
+    }
+
+#ifdef SMARTLED_USE_LUT
+    smartled->_pulseLowWord = (uint32_t)smartled->_pulseLow * 0x01010101u;
+    smartled->_pulseXorWord = (uint32_t)(smartled->_pulseLow ^ smartled->_pulseHigh) * 0x01010101u;
+    smartLED_buildLUT(smartled);
+#endif /* SMARTLED_USE_LUT */
+#ifdef SMARTLED_USE_COLOR_TABLE
+    smartLED_buildColorTable(smartled);
+#endif /* SMARTLED_USE_COLOR_TABLE */
+#ifdef SMARTLED_USE_DITHERING
+    smartled->_ditherError = NULL;
+#endif /* SMARTLED_USE_DITHERING */
+
+    return SMARTLED_SUCCESS;
+}
+
+static smartLED_retStatus_t smartLED_parallelSetup(smartLEDParallel_t* parallel) {
+    if ((parallel->lanesNum < 1) || (parallel->lanesNum > SMARTLED_PARALLEL_MAX_LANES)) {
+        return SMARTLED_ERROR;
+    }
+
+    parallel->_resetBlocks = 0;
+#ifdef SMARTLED_USE_TIMED_RESET
+    parallel->_latchCycles = 0;
+#endif /* SMARTLED_USE_TIMED_RESET */
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        smartLED_t* lane = parallel->lanes[ii];
+
+        if (lane == NULL) {
+            return SMARTLED_ERROR;
+        }
+
+        /* Lanes are written by the same DMA burst, CCR1 to CCRn */
+        lane->htim = parallel->htim;
+        lane->timChannel = TIM_CHANNEL_1 + 4u * ii;
+        lane->LEDperIRQ = parallel->LEDperIRQ;
+        lane->dmaMode = SMARTLED_DMA_CIRCULAR;
+#ifdef SMARTLED_USE_SPI
+        lane->output = SMARTLED_OUTPUT_PWM;
+#endif /* SMARTLED_USE_SPI */
+        if (smartLED_setup(lane) != SMARTLED_SUCCESS) {
+            return SMARTLED_ERROR;
+        }
+
+        /* Each lane encodes one LED in the scratch block, which is then interleaved */
+        lane->_dmaBuffer = parallel->_scratch;
+
+        /* All lanes must have the same LED block length */
+        if (lane->type != parallel->lanes[0]->type) {
+            return SMARTLED_ERROR;
+        }
+        if (lane->_resetBlocks > parallel->_resetBlocks) {
+            parallel->_resetBlocks = lane->_resetBlocks;
+        }
+    }
+    parallel->_LEDBits = parallel->lanes[0]->_LEDBits;
+
+    /* Check that the whole buffer fits a DMA transfer */
+    if ((2u * parallel->LEDperIRQ * parallel->_LEDBits * parallel->lanesNum) > 0xFFFFu) {
+        return SMARTLED_ERROR;
+    }
+
+    return SMARTLED_SUCCESS;
+}
+
+static void smartLED_fillParallelBlock(smartLEDParallel_t* parallel, uint16_t item, uint32_t startingIdx) {
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        uint8_t* dst = &parallel->_dmaBuffer[startingIdx + ii];
+
+        /* Lanes shorter than item are kept low */
+        if (smartLED_fillDMABuffer(parallel->lanes[ii], item, 0) == SMARTLED_SUCCESS) {
+            for (uint32_t jj = 0; jj < parallel->_LEDBits; jj++) {
+                dst[jj * parallel->lanesNum] = parallel->_scratch[jj];
+            }
+        } else {
+            for (uint32_t jj = 0; jj < parallel->_LEDBits; jj++) {
+                dst[jj * parallel->lanesNum] = 0x00;
+            }
+        }
+    }
+}
+
+static void smartLED_startParallelDMA(smartLEDParallel_t* parallel) {
+    static const uint32_t burstLength[SMARTLED_PARALLEL_MAX_LANES] = {TIM_DMABURSTLENGTH_1TRANSFER, TIM_DMABURSTLENGTH_2TRANSFERS,
+                                                                      TIM_DMABURSTLENGTH_3TRANSFERS, TIM_DMABURSTLENGTH_4TRANSFERS};
+
+    /* Outputs stay low until the first update event loads the DMA data */
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        smartLED_t* lane = parallel->lanes[ii];
+
+        __HAL_TIM_SET_COMPARE(parallel->htim, lane->timChannel, 0);
+        if (lane->timType == SMARTLED_TIMER_NORMAL) {
+            HAL_TIM_PWM_Start(parallel->htim, lane->timChannel);
+        } else {
+            HAL_TIMEx_PWMN_Start(parallel->htim, lane->timChannel);
+        }
+    }
+    HAL_TIM_DMABurst_MultiWriteStart(parallel->htim, TIM_DMABASE_CCR1, TIM_DMA_UPDATE, (uint32_t*)parallel->_dmaBuffer,
+                                     burstLength[parallel->lanesNum - 1u], 2u * parallel->LEDperIRQ * parallel->_LEDBits * parallel->lanesNum);
+}
+
+static void smartLED_stopParallelDMA(smartLEDParallel_t* parallel) {
+    HAL_TIM_DMABurst_WriteStop(parallel->htim, TIM_DMA_UPDATE);
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        smartLED_t* lane = parallel->lanes[ii];
+
+        if (lane->timType == SMARTLED_TIMER_NORMAL) {
+            HAL_TIM_PWM_Stop(parallel->htim, lane->timChannel);
+        } else {
+            HAL_TIMEx_PWMN_Stop(parallel->htim, lane->timChannel);
+        }
+        lane->_updating = 0;
+    }
+}
+
+/* Start each strip of the group phaseCycles after the previous one
+ * Delays are measured from the return of the first start, once its DMA is running, so that start times do not add up */
+static smartLED_retStatus_t smartLED_startGroup(smartLEDGroup_t* group, smartLED_retStatus_t (*start)(smartLED_t* smartled)) {
+    smartLED_retStatus_t ret = SMARTLED_SUCCESS;
+    uint32_t groupStart = 0;
+
+    if (smartLED_isGroupUpdating(group)) {
+        return SMARTLED_ERROR;
+    }
+#ifdef SMARTLED_USE_TIMED_RESET
+    for (uint8_t ii = 0; ii < group->stripsNum; ii++) {
+        if (smartLED_isLatching(group->strips[ii])) {
+            return SMARTLED_ERROR;
+        }
+    }
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+    for (uint8_t ii = 0; ii < group->stripsNum; ii++) {
+        while ((uint32_t)(SMARTLED_GET_CYCLES() - groupStart) < ii * group->_phaseCycles) {
+        }
+        if (start(group->strips[ii]) != SMARTLED_SUCCESS) {
+            ret = SMARTLED_ERROR;
+        }
+        if (ii == 0) {
+            groupStart = SMARTLED_GET_CYCLES();
+        }
+    }
+    return ret;
+}
+
+/* Cycles to encode one LED with the current settings, best of a few rounds to leave out the interrupts */
+static uint32_t smartLED_measureEncode(smartLED_t* smartled) {
+    uint8_t scratch[32];
+    uint8_t* DMABuffer = smartled->_dmaBuffer;
+    uint16_t LEDs = (smartled->size < SMARTLED_TUNE_LEDS) ? smartled->size : SMARTLED_TUNE_LEDS;
+    uint32_t best = UINT32_MAX;
+
+    /* Every LED is encoded in the same scratch block, as long as the largest one */
+    smartled->_dmaBuffer = scratch;
+    smartled->_frameSize = smartled->size;
+    smartLED_prepareFrame(smartled);
+    for (uint8_t round = 0; round < SMARTLED_TUNE_ROUNDS; round++) {
+        uint32_t start = SMARTLED_GET_CYCLES(), elapsed;
+
+        for (uint16_t ii = 0; ii < LEDs; ii++) {
+            smartLED_fillDMABuffer(smartled, ii, 0);
+        }
+        elapsed = SMARTLED_GET_CYCLES() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    smartled->_dmaBuffer = DMABuffer;
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
+
+    return (best + LEDs - 1u) / LEDs;
+}
+
+/* Leave the strip as smartLED_initAutoTune() found it, with the caller's LEDperIRQ and no LED data */
+static smartLED_retStatus_t smartLED_abortAutoTune(smartLED_t* smartled, uint8_t LEDperIRQ) {
+    free(smartled->_colorsData);
+    smartled->_colorsData = NULL;
+    smartled->_txData = NULL;
+#ifdef SMARTLED_USE_DITHERING
+    smartled->_ditherError = NULL;
+#endif /* SMARTLED_USE_DITHERING */
+    smartled->LEDperIRQ = LEDperIRQ;
+
+    return SMARTLED_ERROR;
+}
+
+static void smartLED_setDMABuffer(smartLED_t* smartled, uint8_t* DMABuffer) {
+    smartled->_dmaBuffer = DMABuffer;
+
+    /* Reset blocks at the end of a full frame buffer are never encoded */
+    if (smartled->dmaMode == SMARTLED_DMA_FULLFRAME) {
+        memset(DMABuffer, 0x00, sizeof(uint8_t) * smartLED_DMALength(smartled));
+    }
+}
+
+/* Bulk functions write colors stored per LED, within the strip */
+static smartLED_retStatus_t smartLED_checkRange(const smartLED_t* smartled, uint16_t first, uint16_t count) {
+    if ((smartled->_colorsData == NULL) || (smartled->palette != SMARTLED_PALETTE_NONE) || (((uint32_t)first + count) > smartled->size)) {
+        return SMARTLED_ERROR;
+    }
+    return SMARTLED_SUCCESS;
+}
+
+static void smartLED_markRangeDirty(smartLED_t* smartled, uint16_t first, uint16_t count) {
+    if (count) {
+        smartLED_markDirty(smartled, first);
+        smartLED_markDirty(smartled, first + count - 1u);
+    }
+}
+
+/* Reverse the order of count LEDs starting from first */
+static void smartLED_reverseRange(smartLED_t* smartled, uint16_t first, uint16_t count) {
+    uint8_t* head = &smartled->_colorsData[(uint32_t)first * smartled->type];
+    uint8_t* tail = &smartled->_colorsData[((uint32_t)first + count - 1u) * smartled->type];
+
+    for (; head < tail; head += smartled->type, tail -= smartled->type) {
+        for (uint8_t ii = 0; ii < smartled->type; ii++) {
+            uint8_t swap = head[ii];
+
+            head[ii] = tail[ii];
+            tail[ii] = swap;
+        }
+    }
+}
+
+/* Start the transfer of the LEDs up to the last changed one. Changes are tracked on the LED data written by the color functions, which
+ * in double buffer mode is the back buffer: the front buffer alone is sent whole, and the tracked range is left to smartLED_present() */
+static smartLED_retStatus_t smartLED_startFrame(smartLED_t* smartled, uint8_t sendChanges) {
+    if (smartled->_updating) {
+        return SMARTLED_ERROR;
+    }
+#ifdef SMARTLED_USE_TIMED_RESET
+    /* Previous frame is latched only once the line has been low for the whole reset */
+    if (smartLED_isLatching(smartled)) {
+        return SMARTLED_ERROR;
+    }
+#endif /* SMARTLED_USE_TIMED_RESET */
+    smartLED_fadeStep(smartled);
+
+    /* Send LEDs up to the last changed one, or the whole strip */
+    uint8_t wholeStrip = !sendChanges || smartLED_wholeStrip(smartled);
+    uint16_t dirtyStart = wholeStrip ? 0 : smartled->_dirtyStart;
+
+    smartled->_frameSize = wholeStrip ? smartled->size : smartled->_dirtyEnd;
+    if (!smartled->_frameSize) {
+        return SMARTLED_SUCCESS;
+    }
+    smartled->_sentBrightness = smartled->_brightness;
+    if (sendChanges) {
+        smartled->_dirtyStart = smartled->size;
+        smartled->_dirtyEnd = 0;
+    }
+
+#ifdef SMARTLED_USE_STATS
+    smartLED_statsFrameStart(smartled, SMARTLED_GET_CYCLES());
+#endif /* SMARTLED_USE_STATS */
+
+    smartLED_prepareFrame(smartled);
+
+    /* Full frame buffer still holds the previous frame, only changed LEDs are encoded again */
+    if (smartled->dmaMode == SMARTLED_DMA_FULLFRAME) {
+        for (uint16_t ii = dirtyStart; ii < smartled->_frameSize; ii++) {
+            smartLED_fillDMABuffer(smartled, ii, ii * smartled->_LEDBytes);
+        }
+        smartled->_updating = 1;
+        smartLED_startDMA(smartled);
+        return SMARTLED_SUCCESS;
+    }
+
+    /* Set initial values */
+    smartled->_updating = 1;
+    smartled->_cyclesCnt = smartled->LEDperIRQ;
+
+    /* Fill the entire DMA buffer with the first set of elements */
+    memset(smartled->_dmaBuffer, 0x00, sizeof(uint8_t) * 2u * smartled->LEDperIRQ * smartled->_LEDBytes);
+    for (uint16_t ii = 0; ii < 2 * smartled->LEDperIRQ; ii++) {
+        smartLED_fillDMABuffer(smartled, ii, ii * smartled->_LEDBytes);
+    }
+
+    /* Start Transfer */
+    smartLED_startDMA(smartled);
+    return SMARTLED_SUCCESS;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+smartLED_retStatus_t smartLED_init(smartLED_t* smartled) {
+    if (smartLED_setup(smartled) != SMARTLED_SUCCESS) {
+        return SMARTLED_ERROR;
+    }
+
+    smartled->_colorsData = calloc(SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette), sizeof(uint8_t));
+    if (smartled->_colorsData == NULL) {
+        return SMARTLED_ERROR;
+    }
+    smartled->_txData = smartled->_colorsData;
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
+
+    smartled->_dmaBuffer = calloc(smartLED_DMALength(smartled), sizeof(uint8_t));
+    if (smartled->_dmaBuffer == NULL) {
+        return SMARTLED_ERROR;
+    }
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initAutoTune(smartLED_t* smartled, uint32_t RAMBudget, uint16_t marginUs, smartLEDTuning_t* tuning) {
+    smartLEDTuning_t result = {0};
+    uint32_t marginCycles = (uint32_t)(((uint64_t)SystemCoreClock * marginUs) / 1000000u);
+    uint32_t maxLEDs;
+    uint8_t LEDperIRQ = smartled->LEDperIRQ;
+
+    if (smartled->dmaMode != SMARTLED_DMA_CIRCULAR) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Measured before the DMA buffer is allocated, LEDperIRQ is set once known */
+    smartled->LEDperIRQ = 1;
+    if (smartLED_setup(smartled) != SMARTLED_SUCCESS) {
+        smartled->LEDperIRQ = LEDperIRQ;
         return SMARTLED_ERROR;
     }
+    smartled->_colorsData = calloc(SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette), sizeof(uint8_t));
+    if (smartled->_colorsData == NULL) {
+        return smartLED_abortAutoTune(smartled, LEDperIRQ);
+    }
+    smartled->_txData = smartled->_colorsData;
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
+    result.encodeCycles = smartLED_measureEncode(smartled);
 
-    uint8_t r, g, b;
-    uint32_t itemIdx = item * smartled->type;
+    /* Smallest block whose refill ends marginCycles before the DMA needs it, within the RAM budget */
+    maxLEDs = RAMBudget / (2u * smartled->_LEDBytes);
+    if (maxLEDs > 0xFFu) {
+        maxLEDs = 0xFFu;
+    }
+    for (uint32_t LEDs = 1; LEDs <= maxLEDs; LEDs++) {
+        uint32_t IRQCycles = SMARTLED_IRQ_OVERHEAD_CYCLES + LEDs * result.encodeCycles;
+        uint32_t halfCycles = smartLED_LEDsCycles(smartled, LEDs);
 
-    r = (uint8_t)(((uint32_t)smartled->_colorsData[itemIdx] * (uint32_t)smartled->_brightness) / (uint32_t)0xFF);
-    g = (uint8_t)(((uint32_t)smartled->_colorsData[itemIdx + 1] * (uint32_t)smartled->_brightness) / (uint32_t)0xFF);
-    b = (uint8_t)(((uint32_t)smartled->_colorsData[itemIdx + 2] * (uint32_t)smartled->_brightness) / (uint32_t)0xFF);
+        if (halfCycles >= IRQCycles + marginCycles) {
+            result.LEDperIRQ = (uint8_t)LEDs;
+            result.IRQCycles = IRQCycles;
+            result.halfCycles = halfCycles;
+            result.marginCycles = halfCycles - IRQCycles;
+            break;
+        }
+    }
+    if (tuning != NULL) {
+        *tuning = result;
+    }
+    if (!result.LEDperIRQ) {
+        return smartLED_abortAutoTune(smartled, LEDperIRQ);
+    }
 
-    for (uint32_t ii = startingIdx, jj = 7; ii < (8 + startingIdx); ii++, jj--) {
-        smartled->_dmaBuffer[ii] = (g & (1 << jj)) ? smartled->_pulseHigh : smartled->_pulseLow;
-        smartled->_dmaBuffer[ii + 8] = (r & (1 << jj)) ? smartled->_pulseHigh : smartled->_pulseLow;
-        smartled->_dmaBuffer[ii + 16] = (b & (1 << jj)) ? smartled->_pulseHigh : smartled->_pulseLow;
+    smartled->LEDperIRQ = result.LEDperIRQ;
+    smartled->_dmaBuffer = calloc(smartLED_DMALength(smartled), sizeof(uint8_t));
+    if (smartled->_dmaBuffer == NULL) {
+        return smartLED_abortAutoTune(smartled, LEDperIRQ);
     }
+    if (tuning != NULL) {
+        tuning->DMABufferSize = smartLED_DMALength(smartled);
+    }
+
     return SMARTLED_SUCCESS;
 }
 
-/* Functions -----------------------------------------------------------------*/
-
-smartLED_retStatus_t smartLED_init(smartLED_t* smartled) {
-    /* Check chip type */
-    if ((smartled->chip != WS2811) && (smartled->chip != WS2812B)) {
+smartLED_retStatus_t smartLED_initDoubleBuffer(smartLED_t* smartled) {
+    if (smartLED_setup(smartled) != SMARTLED_SUCCESS) {
         return SMARTLED_ERROR;
     }
 
-    /* Check led type */
-    if ((smartled->type != SMARTLED_RGB) && (smartled->type != SMARTLED_RGBW)) {
+    /* Dithering error stays in the array it is set up in, the front one */
+    smartled->_colorsData = calloc(SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette)
+                                       - SMARTLED_DITHER_SIZE(smartled->type, smartled->size, smartled->palette),
+                                   sizeof(uint8_t));
+    if (smartled->_colorsData == NULL) {
         return SMARTLED_ERROR;
     }
 
-    /* Check timer type */
-    if ((smartled->timType != SMARTLED_TIMER_NORMAL) && (smartled->timType != SMARTLED_TIMER_EXTENDED)) {
+    smartled->_txData = calloc(SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette), sizeof(uint8_t));
+    if (smartled->_txData == NULL) {
         return SMARTLED_ERROR;
     }
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
 
-    /* Check number of LEDs per each IRQ */
-    if (smartled->LEDperIRQ < 1) {
+    smartled->_dmaBuffer = calloc(smartLED_DMALength(smartled), sizeof(uint8_t));
+    if (smartled->_dmaBuffer == NULL) {
         return SMARTLED_ERROR;
     }
 
-    /* Check that timer has been configured */
-    if (!smartled->htim->Instance->ARR) {
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, uint8_t* DMABuffer) {
+    if (smartLED_setup(smartled) != SMARTLED_SUCCESS) {
         return SMARTLED_ERROR;
     }
 
-    smartled->_brightness = 0xFF;
-    smartled->_pulseLow = (uint8_t)((float)smartled->htim->Instance->ARR * 0.33f);
-    smartled->_pulseHigh = (uint8_t)((float)smartled->htim->Instance->ARR * 0.65f);
-    smartled->_LEDBits = smartled->type * 8;
+    smartled->_colorsData = data;
+    smartled->_txData = data;
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
+    smartLED_setDMABuffer(smartled, DMABuffer);
 
-    /* Set the right amount of empty LED blocks needed at the beginning to initiate transfer */
-    if (smartled->chip == WS2811) {
-        smartled->_resetBlocks = 280e-3 * SMARTLED_PWM_FREQ / smartled->_LEDBits + 2;
-    } else {
-        smartled->_resetBlocks = 50e-3 * SMARTLED_PWM_FREQ / smartled->_LEDBits + 2;
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initStaticDoubleBuffer(smartLED_t* smartled, uint8_t* data, uint8_t* backData, uint8_t* DMABuffer) {
+    if ((data == backData) || (smartLED_setup(smartled) != SMARTLED_SUCCESS)) {
+        return SMARTLED_ERROR;
     }
 
-    smartled->_colorsData = calloc(smartled->type * smartled->size, sizeof(uint8_t));
-    if (smartled->_colorsData == NULL) {
+    smartled->_colorsData = backData;
+    smartled->_txData = data;
+#ifdef SMARTLED_USE_DITHERING
+    smartLED_setDitherError(smartled);
+#endif /* SMARTLED_USE_DITHERING */
+    smartLED_setDMABuffer(smartled, DMABuffer);
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initShader(smartLED_t* smartled, uint32_t (*shader)(uint16_t index, uint32_t frameCounter)) {
+    if ((shader == NULL) || (smartled->palette != SMARTLED_PALETTE_NONE) || (smartLED_setup(smartled) != SMARTLED_SUCCESS)) {
         return SMARTLED_ERROR;
     }
 
-    smartled->_dmaBuffer = calloc(2 * smartled->LEDperIRQ * smartled->_LEDBits, sizeof(uint8_t));
+    smartled->_shader = shader;
+    smartled->_colorsData = NULL;
+    smartled->_txData = NULL;
+
+    smartled->_dmaBuffer = calloc(smartLED_DMALength(smartled), sizeof(uint8_t));
     if (smartled->_dmaBuffer == NULL) {
         return SMARTLED_ERROR;
     }
@@ -118,70 +1065,302 @@ smartLED_retStatus_t smartLED_init(smartLED_t* smartled) {
     return SMARTLED_SUCCESS;
 }
 
-smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, uint8_t* DMABuffer) {
-    /* Check chip type */
-    if ((smartled->chip != WS2811) && (smartled->chip != WS2812B)) {
+smartLED_retStatus_t smartLED_initShaderStatic(smartLED_t* smartled, uint32_t (*shader)(uint16_t index, uint32_t frameCounter), uint8_t* DMABuffer) {
+    if ((shader == NULL) || (smartled->palette != SMARTLED_PALETTE_NONE) || (smartLED_setup(smartled) != SMARTLED_SUCCESS)) {
         return SMARTLED_ERROR;
     }
 
-    /* Check led type */
-    if ((smartled->type != SMARTLED_RGB) && (smartled->type != SMARTLED_RGBW)) {
+    smartled->_shader = shader;
+    smartled->_colorsData = NULL;
+    smartled->_txData = NULL;
+    smartLED_setDMABuffer(smartled, DMABuffer);
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_fillRGBRange(smartLED_t* smartled, uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue) {
+    uint8_t pattern[12];
+    uint32_t words[3];
+    uint8_t* dst;
+
+    if (smartLED_checkRange(smartled, first, count) != SMARTLED_SUCCESS) {
+        return SMARTLED_ERROR;
+    }
+    dst = &smartled->_colorsData[(uint32_t)first * smartled->type];
+
+    /* One LED per word, white is kept by the mask */
+    if (smartled->type == SMARTLED_RGBW) {
+        uint8_t mask[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+        pattern[smartled->_colorOffset[SMARTLED_RED]] = red;
+        pattern[smartled->_colorOffset[SMARTLED_GREEN]] = green;
+        pattern[smartled->_colorOffset[SMARTLED_BLUE]] = blue;
+        pattern[smartled->_colorOffset[SMARTLED_WHITE]] = 0;
+        mask[smartled->_colorOffset[SMARTLED_WHITE]] = 0;
+        memcpy(&words[0], pattern, sizeof(uint32_t));
+        memcpy(&words[1], mask, sizeof(uint32_t));
+        for (uint16_t ii = 0; ii < count; ii++, dst += 4) {
+            uint32_t word;
+
+            memcpy(&word, dst, sizeof(uint32_t));
+            word = (word & ~words[1]) | words[0];
+            memcpy(dst, &word, sizeof(uint32_t));
+        }
+        smartLED_markRangeDirty(smartled, first, count);
+        return SMARTLED_SUCCESS;
+    }
+
+    /* Four RGB LEDs are three words */
+    for (uint8_t ii = 0; ii < 12u; ii += 3u) {
+        pattern[ii + smartled->_colorOffset[SMARTLED_RED]] = red;
+        pattern[ii + smartled->_colorOffset[SMARTLED_GREEN]] = green;
+        pattern[ii + smartled->_colorOffset[SMARTLED_BLUE]] = blue;
+    }
+    memcpy(words, pattern, sizeof(words));
+    for (uint16_t ii = count >> 2; ii > 0; ii--, dst += 12) {
+        memcpy(dst, &words[0], sizeof(uint32_t));
+        memcpy(dst + 4, &words[1], sizeof(uint32_t));
+        memcpy(dst + 8, &words[2], sizeof(uint32_t));
+    }
+    memcpy(dst, pattern, 3u * (count & 3u));
+    smartLED_markRangeDirty(smartled, first, count);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_fillRGBWRange(smartLED_t* smartled, uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue,
+                                            uint8_t white) {
+    uint8_t pattern[4];
+    uint32_t word;
+    uint8_t* dst;
+
+    if ((smartled->type != SMARTLED_RGBW) || (smartLED_checkRange(smartled, first, count) != SMARTLED_SUCCESS)) {
         return SMARTLED_ERROR;
     }
+    dst = &smartled->_colorsData[(uint32_t)first * 4u];
+
+    pattern[smartled->_colorOffset[SMARTLED_RED]] = red;
+    pattern[smartled->_colorOffset[SMARTLED_GREEN]] = green;
+    pattern[smartled->_colorOffset[SMARTLED_BLUE]] = blue;
+    pattern[smartled->_colorOffset[SMARTLED_WHITE]] = white;
+    memcpy(&word, pattern, sizeof(uint32_t));
+    for (uint16_t ii = 0; ii < count; ii++, dst += 4) {
+        memcpy(dst, &word, sizeof(uint32_t));
+    }
+    smartLED_markRangeDirty(smartled, first, count);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_blit(smartLED_t* smartled, uint16_t first, uint16_t count, const uint8_t* colors, smartLEDColorOrder_t order) {
+    uint8_t* dst;
 
-    /* Check timer type */
-    if ((smartled->timType != SMARTLED_TIMER_NORMAL) && (smartled->timType != SMARTLED_TIMER_EXTENDED)) {
+    if ((colors == NULL) || ((uint32_t)order > SMARTLED_ORDER_BGR) || (smartLED_checkRange(smartled, first, count) != SMARTLED_SUCCESS)) {
         return SMARTLED_ERROR;
     }
+    dst = &smartled->_colorsData[(uint32_t)first * smartled->type];
+
+    if (order == smartled->colorOrder) {
+        memcpy(dst, colors, sizeof(uint8_t) * count * smartled->type);
+    } else {
+        const uint8_t* src = smartLED_colorOffsets[order];
+
+        for (uint16_t ii = 0; ii < count; ii++, dst += smartled->type, colors += smartled->type) {
+            dst[smartled->_colorOffset[SMARTLED_RED]] = colors[src[0]];
+            dst[smartled->_colorOffset[SMARTLED_GREEN]] = colors[src[1]];
+            dst[smartled->_colorOffset[SMARTLED_BLUE]] = colors[src[2]];
+            if (smartled->type == SMARTLED_RGBW) {
+                dst[smartled->_colorOffset[SMARTLED_WHITE]] = colors[3];
+            }
+        }
+    }
+    smartLED_markRangeDirty(smartled, first, count);
+    return SMARTLED_SUCCESS;
+}
 
-    /* Check number of LEDs per each IRQ */
-    if (smartled->LEDperIRQ < 1) {
+smartLED_retStatus_t smartLED_copyRange(smartLED_t* smartled, uint16_t dest, uint16_t source, uint16_t count) {
+    if ((smartLED_checkRange(smartled, dest, count) != SMARTLED_SUCCESS) || (smartLED_checkRange(smartled, source, count) != SMARTLED_SUCCESS)) {
         return SMARTLED_ERROR;
     }
 
-    /* Check that timer has been configured */
-    if (!smartled->htim->Instance->ARR) {
+    memmove(&smartled->_colorsData[(uint32_t)dest * smartled->type], &smartled->_colorsData[(uint32_t)source * smartled->type],
+            sizeof(uint8_t) * count * smartled->type);
+    smartLED_markRangeDirty(smartled, dest, count);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_rotateRange(smartLED_t* smartled, uint16_t first, uint16_t count, int16_t shift) {
+    uint16_t right;
+
+    if (smartLED_checkRange(smartled, first, count) != SMARTLED_SUCCESS) {
         return SMARTLED_ERROR;
     }
+    if (count < 2u) {
+        return SMARTLED_SUCCESS;
+    }
 
-    smartled->_brightness = 0xFF;
-    smartled->_pulseLow = (uint8_t)((float)smartled->htim->Instance->ARR * 0.33f);
-    smartled->_pulseHigh = (uint8_t)((float)smartled->htim->Instance->ARR * 0.65f);
-    smartled->_LEDBits = smartled->type * 8;
+    /* In place rotation by three reversals */
+    right = (uint16_t)(((shift % (int32_t)count) + count) % count);
+    if (right) {
+        smartLED_reverseRange(smartled, first, count);
+        smartLED_reverseRange(smartled, first, right);
+        smartLED_reverseRange(smartled, first + right, count - right);
+        smartLED_markRangeDirty(smartled, first, count);
+    }
+    return SMARTLED_SUCCESS;
+}
 
-    /* Set the right amount of empty LED blocks needed between two consecutive transfers */
-    if (smartled->chip == WS2811) {
-        smartled->_resetBlocks = 280e-3 * SMARTLED_PWM_FREQ / smartled->_LEDBits + 2;
-    } else {
-        smartled->_resetBlocks = 50e-3 * SMARTLED_PWM_FREQ / smartled->_LEDBits + 2;
+uint32_t smartLED_HSVToRGB(uint8_t hue, uint8_t saturation, uint8_t value) {
+    if (!saturation) {
+        return SMARTLED_RGB_COLOR(value, value, value);
     }
-    smartled->_colorsData = data;
-    smartled->_dmaBuffer = DMABuffer;
 
+    /* Six sectors of 256 steps each */
+    uint32_t position = (uint32_t)hue * 6u;
+    uint32_t fraction = position & 0xFFu;
+    uint32_t low = (value * (256u - saturation)) >> 8;
+    uint32_t falling = (value * (256u - ((saturation * fraction) >> 8))) >> 8;
+    uint32_t rising = (value * (256u - ((saturation * (256u - fraction)) >> 8))) >> 8;
+
+    switch (position >> 8) {
+        case 0: return SMARTLED_RGB_COLOR(value, rising, low);
+        case 1: return SMARTLED_RGB_COLOR(falling, value, low);
+        case 2: return SMARTLED_RGB_COLOR(low, value, rising);
+        case 3: return SMARTLED_RGB_COLOR(low, falling, value);
+        case 4: return SMARTLED_RGB_COLOR(rising, low, value);
+        default: return SMARTLED_RGB_COLOR(value, low, falling);
+    }
+}
+
+smartLED_retStatus_t smartLED_blitHSV(smartLED_t* smartled, uint16_t first, uint16_t count, const uint8_t* HSV) {
+    uint8_t* dst;
+
+    if ((HSV == NULL) || (smartLED_checkRange(smartled, first, count) != SMARTLED_SUCCESS)) {
+        return SMARTLED_ERROR;
+    }
+    dst = &smartled->_colorsData[(uint32_t)first * smartled->type];
+
+    for (uint16_t ii = 0; ii < count; ii++, dst += smartled->type, HSV += 3) {
+        uint32_t color = smartLED_HSVToRGB(HSV[0], HSV[1], HSV[2]);
+
+        dst[smartled->_colorOffset[SMARTLED_RED]] = (uint8_t)(color >> 16);
+        dst[smartled->_colorOffset[SMARTLED_GREEN]] = (uint8_t)(color >> 8);
+        dst[smartled->_colorOffset[SMARTLED_BLUE]] = (uint8_t)color;
+    }
+    smartLED_markRangeDirty(smartled, first, count);
     return SMARTLED_SUCCESS;
 }
 
-smartLED_retStatus_t smartLED_startTransfer(smartLED_t* smartled) {
+smartLED_retStatus_t smartLED_startTransfer(smartLED_t* smartled) { return smartLED_startFrame(smartled, smartled->_txData == smartled->_colorsData); }
+
+smartLED_retStatus_t smartLED_present(smartLED_t* smartled) {
+    uint8_t* front = smartled->_colorsData;
+
+    /* Back buffer is the target of the crossfade */
+    if (smartled->_fadeFrames) {
+        return SMARTLED_ERROR;
+    }
+
+    /* While streaming, the ISR swaps buffers at the next frame boundary */
+    if (smartled->_streamState == SMARTLED_STREAM_RUNNING) {
+        if (smartled->_pendingSwap) {
+            return SMARTLED_ERROR;
+        }
+        smartled->_pendingSwap = (smartled->_txData != smartled->_colorsData);
+        return SMARTLED_SUCCESS;
+    }
+
     if (smartled->_updating) {
         return SMARTLED_ERROR;
     }
+#ifdef SMARTLED_USE_TIMED_RESET
+    /* Buffers are not swapped unless the transfer can start */
+    if (smartLED_isLatching(smartled)) {
+        return SMARTLED_ERROR;
+    }
+#endif /* SMARTLED_USE_TIMED_RESET */
 
-    /* Set initial values */
-    smartled->_updating = 1;
-    smartled->_cyclesCnt = smartled->LEDperIRQ;
+    /* Single buffer, nothing to swap */
+    if (smartled->_txData == smartled->_colorsData) {
+        return smartLED_startTransfer(smartled);
+    }
 
-    /* Fill the entire DMA buffer with the first set of elements */
-    memset(smartled->_dmaBuffer, 0x00, sizeof(uint8_t) * 2u * smartled->LEDperIRQ * smartled->_LEDBits);
-    for (uint16_t ii = 0; ii < 2 * smartled->LEDperIRQ; ii++) {
-        smartLED_fillDMABuffer(smartled, ii, ii * smartled->_LEDBits);
+    /* No transfer is running, so the ISR is not reading _txData while pointers are swapped */
+    smartled->_colorsData = smartled->_txData;
+    smartled->_txData = front;
+    smartled->_paletteDirty = 1;
+    if (smartLED_startFrame(smartled, 1) != SMARTLED_SUCCESS) {
+        return SMARTLED_ERROR;
     }
 
-    /* Start Transfer */
-    if (smartled->timType == SMARTLED_TIMER_NORMAL) {
-        HAL_TIM_PWM_Start_DMA(smartled->htim, smartled->timChannel, (uint32_t*)smartled->_dmaBuffer, 2 * smartled->LEDperIRQ * smartled->_LEDBits);
-    } else {
-        HAL_TIMEx_PWMN_Start_DMA(smartled->htim, smartled->timChannel, (uint32_t*)smartled->_dmaBuffer, 2 * smartled->LEDperIRQ * smartled->_LEDBits);
+    /* The new back buffer starts from the frame being transmitted, which is only read by the ISR */
+    /* Dithering error stays in the array it was set up in */
+    memcpy(smartled->_colorsData, smartled->_txData,
+           sizeof(uint8_t)
+               * (SMARTLED_DATA_SIZE(smartled->type, smartled->size, smartled->palette)
+                  - SMARTLED_DITHER_SIZE(smartled->type, smartled->size, smartled->palette)));
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_crossfade(smartLED_t* smartled, uint16_t frames) {
+    if ((frames < 1) || (smartled->_txData == smartled->_colorsData) || (smartled->palette != SMARTLED_PALETTE_NONE) || smartled->_fadeFrames
+        || smartled->_pendingSwap) {
+        return SMARTLED_ERROR;
+    }
+
+    /* A blend of 0 sends the front buffer unchanged until the first step, so the ISR may see the fade at any time */
+    smartled->_fadeBlend = 0;
+    smartled->_fadeFrame = 0;
+    smartled->_fadeFrames = frames;
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_startStreaming(smartLED_t* smartled, uint16_t refreshRate, void (*frameCallback)(smartLED_t*)) {
+    uint32_t frameLEDs = (uint32_t)smartled->size + smartled->_resetBlocks;
+
+    if (smartled->_updating || (smartled->dmaMode == SMARTLED_DMA_FULLFRAME)) {
+        return SMARTLED_ERROR;
+    }
+#ifdef SMARTLED_USE_TIMED_RESET
+    if (smartLED_isLatching(smartled)) {
+        return SMARTLED_ERROR;
+    }
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+    /* Frame period in LED blocks, the reset gap is extended up to the end of the period */
+    if (refreshRate) {
+        uint32_t periodLEDs = (SMARTLED_PWM_FREQ * 1000u) / ((uint32_t)refreshRate * smartled->_LEDBits);
+
+        if (periodLEDs < frameLEDs) {
+            return SMARTLED_ERROR;
+        }
+        frameLEDs = periodLEDs;
+    }
+
+    smartled->_streamFrameLEDs = frameLEDs;
+    smartled->_streamPos = 0;
+    smartled->_frameCallback = frameCallback;
+    smartled->_pendingSwap = 0;
+    smartled->_frameSize = smartled->size;
+    smartled->_streamState = SMARTLED_STREAM_RUNNING;
+    smartled->_updating = 1;
+
+#ifdef SMARTLED_USE_STATS
+    smartLED_statsFrameStart(smartled, SMARTLED_GET_CYCLES());
+#endif /* SMARTLED_USE_STATS */
+
+    /* Fill the entire DMA buffer, starting from the first frame */
+    smartLED_streamFill(smartled, 0);
+    smartLED_streamFill(smartled, (uint32_t)smartled->LEDperIRQ * smartled->_LEDBytes);
+
+    smartLED_startDMA(smartled);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_stopStreaming(smartLED_t* smartled) {
+    if (smartled->_streamState != SMARTLED_STREAM_RUNNING) {
+        return SMARTLED_ERROR;
     }
+
+    smartled->_streamState = SMARTLED_STREAM_STOP_REQUESTED;
     return SMARTLED_SUCCESS;
 }
 
@@ -189,42 +1368,279 @@ smartLED_retStatus_t smartLED_updateTransfer(smartLED_t* smartled, smartLEDIRQTy
     if (!smartled->_updating) {
         return SMARTLED_ERROR;
     }
+#ifdef SMARTLED_USE_STATS
+    uint32_t IRQStart = SMARTLED_GET_CYCLES();
+#endif /* SMARTLED_USE_STATS */
+    uint8_t frameDone = 0;
+
     /* When interrupt is triggered, DMA already started transfer of the next half of the buffer, 
      * so the code rewrites the one that was just transmitted */
-    uint32_t DMABuffHalfCpltLen = (uint32_t)(smartled->LEDperIRQ * smartled->_LEDBits);
+    uint32_t DMABuffHalfCpltLen = (uint32_t)(smartled->LEDperIRQ * smartled->_LEDBytes);
+
+    /* Whole frame was in the buffer, the transfer is over */
+    if (smartled->dmaMode == SMARTLED_DMA_FULLFRAME) {
+        if (PWM_IRQ == SMARTLED_IRQ_FINISHED) {
+            smartLED_stopDMA(smartled);
+            smartled->_updating = 0;
+            smartled->_frameCounter++;
+            frameDone = 1;
+        }
+#ifdef SMARTLED_USE_STATS
+        smartLED_statsIRQ(smartled, IRQStart, frameDone);
+#endif /* SMARTLED_USE_STATS */
+        return SMARTLED_SUCCESS;
+    }
+
+    if (smartled->_streamState != SMARTLED_STREAM_OFF) {
+        if (smartled->_streamState == SMARTLED_STREAM_FLUSHING) {
+            /* Half buffer holding the end of the last frame is being sent, follow it with zeros only */
+            memset(&(smartled->_dmaBuffer[PWM_IRQ * DMABuffHalfCpltLen]), 0x00, sizeof(uint8_t) * DMABuffHalfCpltLen);
+            smartled->_streamState = SMARTLED_STREAM_STOPPING;
+        } else if (smartled->_streamState == SMARTLED_STREAM_STOPPING) {
+            smartLED_stopDMA(smartled);
+            smartled->_streamState = SMARTLED_STREAM_OFF;
+            smartled->_updating = 0;
+        } else {
+            frameDone = smartLED_streamFill(smartled, PWM_IRQ * DMABuffHalfCpltLen);
+        }
+#ifdef SMARTLED_USE_STATS
+        smartLED_statsIRQ(smartled, IRQStart, frameDone);
+#endif /* SMARTLED_USE_STATS */
+        return SMARTLED_SUCCESS;
+    }
 
     /* Interrupts are triggered (TC or HT) when DMA transfers `smartled->LEDperIRQ` led cycles of data elements
      * The increment of _cyclesCnt is anticipated compared to the actual transfer */
     smartled->_cyclesCnt += smartled->LEDperIRQ;
 
-    if (smartled->_cyclesCnt < smartled->size) {
+    if (smartled->_cyclesCnt < smartled->_frameSize) {
         uint16_t next_led = smartled->_cyclesCnt;
         uint8_t counter = 0;
         uint32_t startIdx = PWM_IRQ * DMABuffHalfCpltLen;
 
         /* Fill buffer with led data, paying attention to alignment with post reset blocks*/
-        for (; counter < smartled->LEDperIRQ && next_led < smartled->size; counter++, next_led++) {
-            smartLED_fillDMABuffer(smartled, next_led, startIdx + counter * smartled->_LEDBits);
+        if ((next_led + smartled->LEDperIRQ <= smartled->_frameSize) && smartLED_useEncodeBlock(smartled)) {
+            smartled->_encodeBlock(smartled, next_led, &(smartled->_dmaBuffer[startIdx]));
+            counter = smartled->LEDperIRQ;
+        }
+        for (; counter < smartled->LEDperIRQ && next_led < smartled->_frameSize; counter++, next_led++) {
+            smartLED_fillDMABuffer(smartled, next_led, startIdx + counter * smartled->_LEDBytes);
         }
         if (counter < smartled->LEDperIRQ) {
-            memset(&(smartled->_dmaBuffer[startIdx + counter * smartled->_LEDBits]), 0x00,
-                   sizeof(uint8_t) * (smartled->LEDperIRQ - counter) * smartled->type * 8u);
+            memset(&(smartled->_dmaBuffer[startIdx + counter * smartled->_LEDBytes]), 0x00,
+                   sizeof(uint8_t) * (smartled->LEDperIRQ - counter) * smartled->_LEDBytes);
         }
-    } else if (smartled->_cyclesCnt < (uint32_t)(smartled->_resetBlocks + smartled->size + smartled->LEDperIRQ)) {
+    } else if (smartled->_cyclesCnt < smartLED_stopBlocks(smartled->_resetBlocks) + smartled->_frameSize + smartled->LEDperIRQ) {
         /* Reset array to all zeros after transfer is complete 
          * Reset happens just once, not to waste CPU resources 
-         * It assumes to send at least another _resetBlocks number of empty LED blocks after transfer is completed */
-        if (smartled->_cyclesCnt < (smartled->size + 2u * smartled->LEDperIRQ)) {
+         * It assumes to send at least another smartLED_stopBlocks() number of empty LED blocks after transfer is completed */
+        if (smartled->_cyclesCnt < (smartled->_frameSize + 2u * smartled->LEDperIRQ)) {
             memset(&(smartled->_dmaBuffer[PWM_IRQ * DMABuffHalfCpltLen]), 0x00, sizeof(uint8_t) * DMABuffHalfCpltLen);
         }
     } else {
         /* Stop PWM */
-        if (smartled->timType == SMARTLED_TIMER_NORMAL) {
-            HAL_TIM_PWM_Stop_DMA(smartled->htim, smartled->timChannel);
-        } else {
-            HAL_TIMEx_PWMN_Stop_DMA(smartled->htim, smartled->timChannel);
-        }
+        smartLED_stopDMA(smartled);
+#ifdef SMARTLED_USE_TIMED_RESET
+        smartled->_latchStart = SMARTLED_GET_CYCLES();
+        smartled->_latchCycles =
+            smartLED_latchCycles(smartled->_resetBlocks, smartled->_cyclesCnt - smartled->LEDperIRQ - smartled->_frameSize, smartled->_LEDBits);
+#endif /* SMARTLED_USE_TIMED_RESET */
         smartled->_updating = 0;
+        smartled->_frameCounter++;
+        frameDone = 1;
+    }
+
+#ifdef SMARTLED_USE_STATS
+    smartLED_statsIRQ(smartled, IRQStart, frameDone);
+#else
+    (void)frameDone;
+#endif /* SMARTLED_USE_STATS */
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initParallel(smartLEDParallel_t* parallel) {
+    if (smartLED_parallelSetup(parallel) != SMARTLED_SUCCESS) {
+        return SMARTLED_ERROR;
+    }
+
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        smartLED_t* lane = parallel->lanes[ii];
+
+        lane->_colorsData = calloc(SMARTLED_DATA_SIZE(lane->type, lane->size, lane->palette), sizeof(uint8_t));
+        if (lane->_colorsData == NULL) {
+            return SMARTLED_ERROR;
+        }
+        lane->_txData = lane->_colorsData;
+#ifdef SMARTLED_USE_DITHERING
+        smartLED_setDitherError(lane);
+#endif /* SMARTLED_USE_DITHERING */
+    }
+
+    parallel->_dmaBuffer = calloc(2 * parallel->LEDperIRQ * parallel->_LEDBits * parallel->lanesNum, sizeof(uint8_t));
+    if (parallel->_dmaBuffer == NULL) {
+        return SMARTLED_ERROR;
+    }
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initParallelStatic(smartLEDParallel_t* parallel, uint8_t* const data[], uint8_t* DMABuffer) {
+    if (smartLED_parallelSetup(parallel) != SMARTLED_SUCCESS) {
+        return SMARTLED_ERROR;
+    }
+
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        parallel->lanes[ii]->_colorsData = data[ii];
+        parallel->lanes[ii]->_txData = data[ii];
+#ifdef SMARTLED_USE_DITHERING
+        smartLED_setDitherError(parallel->lanes[ii]);
+#endif /* SMARTLED_USE_DITHERING */
+    }
+    parallel->_dmaBuffer = DMABuffer;
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_startParallelTransfer(smartLEDParallel_t* parallel) {
+    if (parallel->_updating) {
+        return SMARTLED_ERROR;
+    }
+#ifdef SMARTLED_USE_TIMED_RESET
+    if (smartLED_latching(parallel->_latchStart, &parallel->_latchCycles)) {
+        return SMARTLED_ERROR;
+    }
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+    /* Each lane sends up to its last changed LED, the frame lasts as the longest one */
+    parallel->_frameSize = 0;
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        smartLED_t* lane = parallel->lanes[ii];
+
+        lane->_frameSize = smartLED_wholeStrip(lane) ? lane->size : lane->_dirtyEnd;
+        lane->_sentBrightness = lane->_brightness;
+        lane->_dirtyStart = lane->size;
+        lane->_dirtyEnd = 0;
+        if (lane->_frameSize > parallel->_frameSize) {
+            parallel->_frameSize = lane->_frameSize;
+        }
+        smartLED_prepareFrame(lane);
+    }
+    if (!parallel->_frameSize) {
+        return SMARTLED_SUCCESS;
+    }
+
+    /* Set initial values, lanes cannot be started on their own while the group is sending */
+    for (uint8_t ii = 0; ii < parallel->lanesNum; ii++) {
+        parallel->lanes[ii]->_updating = 1;
+    }
+    parallel->_updating = 1;
+    parallel->_cyclesCnt = parallel->LEDperIRQ;
+
+    /* Fill the entire DMA buffer with the first set of elements */
+    for (uint16_t ii = 0; ii < 2 * parallel->LEDperIRQ; ii++) {
+        smartLED_fillParallelBlock(parallel, ii, ii * parallel->_LEDBits * parallel->lanesNum);
+    }
+
+    /* Start Transfer */
+    smartLED_startParallelDMA(parallel);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_updateParallelTransfer(smartLEDParallel_t* parallel, smartLEDIRQType_t PWM_IRQ) {
+    if (!parallel->_updating) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Same sequence as smartLED_updateTransfer(), on blocks of lanesNum interleaved LEDs */
+    uint32_t blockLen = (uint32_t)parallel->_LEDBits * parallel->lanesNum;
+    uint32_t DMABuffHalfCpltLen = parallel->LEDperIRQ * blockLen;
+
+    parallel->_cyclesCnt += parallel->LEDperIRQ;
+
+    if (parallel->_cyclesCnt < parallel->_frameSize) {
+        uint16_t next_led = parallel->_cyclesCnt;
+        uint8_t counter = 0;
+        uint32_t startIdx = PWM_IRQ * DMABuffHalfCpltLen;
+
+        for (; counter < parallel->LEDperIRQ && next_led < parallel->_frameSize; counter++, next_led++) {
+            smartLED_fillParallelBlock(parallel, next_led, startIdx + counter * blockLen);
+        }
+        if (counter < parallel->LEDperIRQ) {
+            memset(&(parallel->_dmaBuffer[startIdx + counter * blockLen]), 0x00, sizeof(uint8_t) * (parallel->LEDperIRQ - counter) * blockLen);
+        }
+    } else if (parallel->_cyclesCnt < smartLED_stopBlocks(parallel->_resetBlocks) + parallel->_frameSize + parallel->LEDperIRQ) {
+        if (parallel->_cyclesCnt < (parallel->_frameSize + 2u * parallel->LEDperIRQ)) {
+            memset(&(parallel->_dmaBuffer[PWM_IRQ * DMABuffHalfCpltLen]), 0x00, sizeof(uint8_t) * DMABuffHalfCpltLen);
+        }
+    } else {
+        smartLED_stopParallelDMA(parallel);
+#ifdef SMARTLED_USE_TIMED_RESET
+        parallel->_latchStart = SMARTLED_GET_CYCLES();
+        parallel->_latchCycles =
+            smartLED_latchCycles(parallel->_resetBlocks, parallel->_cyclesCnt - parallel->LEDperIRQ - parallel->_frameSize, parallel->_LEDBits);
+#endif /* SMARTLED_USE_TIMED_RESET */
+        parallel->_updating = 0;
+    }
+
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_initGroup(smartLEDGroup_t* group) {
+    uint32_t halfCycles = UINT32_MAX;
+
+    if ((group->stripsNum < 1) || (group->stripsNum > SMARTLED_GROUP_MAX_STRIPS)) {
+        return SMARTLED_ERROR;
+    }
+
+    /* Strips must be initialized and listed once */
+    for (uint8_t ii = 0; ii < group->stripsNum; ii++) {
+        smartLED_t* smartled = group->strips[ii];
+
+        if ((smartled == NULL) || (smartled->_dmaBuffer == NULL)) {
+            return SMARTLED_ERROR;
+        }
+        for (uint8_t jj = 0; jj < ii; jj++) {
+            if (group->strips[jj] == smartled) {
+                return SMARTLED_ERROR;
+            }
+        }
+
+        /* Full-frame strips only interrupt at the end of the frame */
+        if ((smartled->dmaMode == SMARTLED_DMA_CIRCULAR) && (smartLED_LEDsCycles(smartled, smartled->LEDperIRQ) < halfCycles)) {
+            halfCycles = smartLED_LEDsCycles(smartled, smartled->LEDperIRQ);
+        }
+    }
+
+    /* Spread the starts over one half buffer, so that each strip interrupts between two interrupts of the previous one */
+    group->_phaseCycles = (halfCycles == UINT32_MAX) ? 0 : (halfCycles / group->stripsNum);
+    return SMARTLED_SUCCESS;
+}
+
+smartLED_retStatus_t smartLED_startGroupTransfer(smartLEDGroup_t* group) { return smartLED_startGroup(group, smartLED_startTransfer); }
+
+smartLED_retStatus_t smartLED_presentGroup(smartLEDGroup_t* group) { return smartLED_startGroup(group, smartLED_present); }
+
+uint8_t smartLED_isGroupUpdating(const smartLEDGroup_t* group) {
+    for (uint8_t ii = 0; ii < group->stripsNum; ii++) {
+        if (smartLED_isUpdating(group->strips[ii])) {
+            return 1;
+        }
     }
+    return 0;
+}
+
+#ifdef SMARTLED_USE_TIMED_RESET
+uint8_t smartLED_isLatching(smartLED_t* smartled) { return smartLED_latching(smartled->_latchStart, &smartled->_latchCycles); }
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+#ifdef SMARTLED_USE_STATS
+smartLED_retStatus_t smartLED_getStats(const smartLED_t* smartled, smartLEDStats_t* stats) {
+    *stats = smartled->_stats;
     return SMARTLED_SUCCESS;
-}
\ No newline at end of file
+}
+
+smartLED_retStatus_t smartLED_resetStats(smartLED_t* smartled) {
+    memset(&smartled->_stats, 0x00, sizeof(smartLEDStats_t));
+    return SMARTLED_SUCCESS;
+}
+#endif /* SMARTLED_USE_STATS */
\ No newline at end of file
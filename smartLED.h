@@ -41,8 +41,72 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 
 #include <stdint.h>
+#include <string.h>
 #include "commonTypes.h"
 #include "tim.h"
+#ifdef SMARTLED_USE_SPI
+#include "spi.h"
+#endif /* SMARTLED_USE_SPI */
+
+/* Macros --------------------------------------------------------------------*/
+
+/* PWM frequency in kHz */
+#ifndef SMARTLED_PWM_FREQ
+#define SMARTLED_PWM_FREQ 800
+#endif /* SMARTLED_PWM_FREQ */
+
+/* Cycle counter used for timing measurements, DWT counter must be enabled by the application */
+#ifndef SMARTLED_GET_CYCLES
+#define SMARTLED_GET_CYCLES() (DWT->CYCCNT)
+#endif /* SMARTLED_GET_CYCLES */
+
+/* Cycles spent by a refill IRQ besides encoding (exception entry and exit, HAL DMA and timer handlers), used by smartLED_initAutoTune() */
+#ifndef SMARTLED_IRQ_OVERHEAD_CYCLES
+#define SMARTLED_IRQ_OVERHEAD_CYCLES 300u
+#endif /* SMARTLED_IRQ_OVERHEAD_CYCLES */
+
+/* Number of empty LED blocks sent after data to latch the colors, or the time they take with SMARTLED_USE_TIMED_RESET */
+#define SMARTLED_RESET_BLOCKS(chip, type) (((((chip) == WS2811) ? 280u : 50u) * SMARTLED_PWM_FREQ) / (1000u * 8u * (uint32_t)(type)) + 2u)
+
+/* Color returned by pixel shaders, 0xWWRRGGBB */
+#define SMARTLED_RGB_COLOR(red, green, blue)         (((uint32_t)((red) & 0xFF) << 16) | ((uint32_t)((green) & 0xFF) << 8) | (uint32_t)((blue) & 0xFF))
+#define SMARTLED_RGBW_COLOR(red, green, blue, white) (((uint32_t)((white) & 0xFF) << 24) | SMARTLED_RGB_COLOR(red, green, blue))
+
+/* 16-bit color table, gamma corrected and/or scaled with fractional precision for dithering */
+#if defined(SMARTLED_USE_GAMMA) || defined(SMARTLED_USE_DITHERING)
+#define SMARTLED_USE_COLOR_TABLE
+#endif
+
+/* Size in bytes of the dithering error kept after the colors of the LED data array */
+#ifdef SMARTLED_USE_DITHERING
+#define SMARTLED_DITHER_SIZE(type, size, palette) (((palette) == SMARTLED_PALETTE_NONE) ? ((uint32_t)(type) * (size)) : 0u)
+#else
+#define SMARTLED_DITHER_SIZE(type, size, palette) 0u
+#endif /* SMARTLED_USE_DITHERING */
+
+/* Size in bytes of the LED data array of a strip, to be used with the static init functions */
+#define SMARTLED_DATA_SIZE(type, size, palette)                                                                                                                \
+    ((((palette) == SMARTLED_PALETTE_NONE) ? ((uint32_t)(type) * (size))                                                                                       \
+                                           : ((2u << (palette)) * (uint32_t)(type) + (((uint32_t)(size) * (palette) + 7u) >> 3)))                              \
+     + SMARTLED_DITHER_SIZE(type, size, palette))
+
+/* Size in bytes of the circular DMA buffer of a PWM strip, two halves of LEDperIRQ LEDs */
+#define SMARTLED_DMA_SIZE(type, LEDperIRQ) (2u * (uint32_t)(LEDperIRQ) * (uint32_t)(type) * 8u)
+
+/* Loop unrolling hint for the encoders specialized by SMARTLED_DEFINE_STATIC, loops of up to 32 iterations are fully unrolled */
+#if defined(__clang__)
+#define SMARTLED_UNROLL _Pragma("unroll 32")
+#elif defined(__GNUC__)
+#define SMARTLED_UNROLL _Pragma("GCC unroll 32")
+#else
+#define SMARTLED_UNROLL
+#endif
+
+/* Maximum number of lanes driven by one timer in parallel mode, one per timer channel */
+#define SMARTLED_PARALLEL_MAX_LANES 4
+
+/* Maximum number of strips started together by a strip group */
+#define SMARTLED_GROUP_MAX_STRIPS 8
 
 /* Typedefs ------------------------------------------------------------------*/
 
@@ -80,6 +144,44 @@ typedef enum {
     SMARTLED_TIMER_EXTENDED = 1,
 } smartLEDTimerType_t;
 
+/**
+ * Output peripheral, SPI outputs are available with SMARTLED_USE_SPI
+ */
+typedef enum {
+    SMARTLED_OUTPUT_PWM = 0,
+    SMARTLED_OUTPUT_SPI_3BIT = 3, // 3 SPI bits per LED bit, SPI clock = 3 * SMARTLED_PWM_FREQ
+    SMARTLED_OUTPUT_SPI_4BIT = 4, // 4 SPI bits per LED bit, SPI clock = 4 * SMARTLED_PWM_FREQ
+} smartLEDOutput_t;
+
+/**
+ * DMA buffer mode
+ */
+typedef enum {
+    SMARTLED_DMA_CIRCULAR = 0,  // circular half buffers of LEDperIRQ LEDs, refilled by the interrupts
+    SMARTLED_DMA_FULLFRAME = 1, // whole frame and reset encoded in a linear buffer, sent with a single normal mode DMA transfer
+} smartLEDDMAMode_t;
+
+/**
+ * Order of the colors on the wire, white is always sent last on RGBW LEDs
+ */
+typedef enum {
+    SMARTLED_ORDER_GRB = 0,
+    SMARTLED_ORDER_RGB = 1,
+    SMARTLED_ORDER_BRG = 2,
+    SMARTLED_ORDER_RBG = 3,
+    SMARTLED_ORDER_GBR = 4,
+    SMARTLED_ORDER_BGR = 5,
+} smartLEDColorOrder_t;
+
+/**
+ * Color mode: colors stored per LED, or indices to a 16 or 256 colors palette
+ */
+typedef enum {
+    SMARTLED_PALETTE_NONE = 0,
+    SMARTLED_PALETTE_4BIT = 4, // 4-bit indices, 2 LEDs per byte, 16 colors palette
+    SMARTLED_PALETTE_8BIT = 8, // 8-bit indices, 256 colors palette
+} smartLEDPalette_t;
+
 /**
  * PWM Interrupt type
  */
@@ -88,15 +190,51 @@ typedef enum {
     SMARTLED_IRQ_FINISHED = 1,
 } smartLEDIRQType_t;
 
+/**
+ * Streaming state
+ */
+typedef enum {
+    SMARTLED_STREAM_OFF = 0,
+    SMARTLED_STREAM_RUNNING = 1,
+    SMARTLED_STREAM_STOP_REQUESTED = 2,
+    SMARTLED_STREAM_FLUSHING = 3,
+    SMARTLED_STREAM_STOPPING = 4,
+} smartLEDStreamState_t;
+
 /*
 * SMARTLED return status
 */
 typedef enum { SMARTLED_SUCCESS = 0, SMARTLED_ERROR = 1, SMARTLED_TIMEOUT = 2 } smartLED_retStatus_t;
 
 /**
- * LED struct
+ * Transfer statistics, available with SMARTLED_USE_STATS
+ */
+typedef struct {
+    uint32_t IRQCyclesMin;    // shortest smartLED_updateTransfer() of the last frame, in cycles
+    uint32_t IRQCyclesMax;    // longest smartLED_updateTransfer() of the last frame, in cycles
+    uint32_t IRQCyclesAvg;    // average smartLED_updateTransfer() of the last frame, in cycles
+    uint32_t IRQCount;        // number of IRQs of the last frame
+    uint32_t frameCycles;     // cycles from smartLED_startTransfer() to the end of the last frame
+    uint32_t lateRefills;     // IRQs that completed the refill after the DMA came back to the refilled half, always 0 with SMARTLED_DMA_FULLFRAME
+    uint32_t framesCompleted; // number of completed frames
+} smartLEDStats_t;
+
+/**
+ * LEDperIRQ chosen by smartLED_initAutoTune() and the measurements it is based on, in SMARTLED_GET_CYCLES() cycles
  */
 typedef struct {
+    uint8_t LEDperIRQ;      // chosen number of LEDs per IRQ, 0 if no value fits
+    uint32_t encodeCycles;  // measured cost of encoding one LED
+    uint32_t IRQCycles;     // estimated cost of one refill IRQ, SMARTLED_IRQ_OVERHEAD_CYCLES + LEDperIRQ * encodeCycles
+    uint32_t halfCycles;    // time taken by the DMA to send half buffer, deadline of the refill
+    uint32_t marginCycles;  // time left between the end of the refill and the deadline
+    uint32_t DMABufferSize; // bytes allocated for the DMA buffer
+} smartLEDTuning_t;
+
+/**
+ * LED struct
+ */
+typedef struct smartLED_s {
     /* Public */
     smartLEDChip_t chip;
     smartLEDType_t type;
@@ -105,17 +243,103 @@ typedef struct {
     smartLEDTimerType_t timType;
     uint32_t timChannel;
     uint8_t LEDperIRQ; // number of LEDs to be updated per each PWM IRQ
+    smartLEDPalette_t palette; // SMARTLED_PALETTE_NONE to store colors per LED
+    smartLEDColorOrder_t colorOrder; // SMARTLED_ORDER_GRB for WS2812B
+    smartLEDDMAMode_t dmaMode;       // SMARTLED_DMA_CIRCULAR, or SMARTLED_DMA_FULLFRAME for short strips
+#ifdef SMARTLED_USE_SPI
+    smartLEDOutput_t output;   // SMARTLED_OUTPUT_PWM uses htim, SPI outputs use hspi
+    SPI_HandleTypeDef* hspi;
+#endif /* SMARTLED_USE_SPI */
     /* Private */
-    uint8_t* _colorsData;
+    uint8_t* _colorsData;          // colors written by the application (back buffer in double buffer mode)
+    uint8_t* _txData;              // colors read by the ISR (front buffer in double buffer mode, _colorsData otherwise)
     uint8_t* _dmaBuffer;
     uint8_t _brightness;
     uint8_t _updating;
     uint32_t _cyclesCnt;
     uint8_t _pulseLow, _pulseHigh; // length of 0 and 1 PWM pulses
     uint8_t _LEDBits;              // bits to define LED color (8 * num of colors)
-    uint8_t _resetBlocks;          // number of 1-led-transmission-time" blocks to send logical `0` to the bus, indicating reset before data transmission starts
+    uint8_t _LEDBytes;             // DMA buffer bytes to send one LED
+    uint8_t _colorOffset[4];       // position of SMARTLED_RED, SMARTLED_GREEN, SMARTLED_BLUE and SMARTLED_WHITE in the LED data, in wire order
+    uint16_t _dirtyStart;          // index of the first LED changed since the previous transfer
+    uint16_t _dirtyEnd;            // index of the last LED changed since the previous transfer + 1
+    uint16_t _frameSize;           // number of LEDs sent by the current transfer
+    uint8_t _sentBrightness;       // brightness of the previous transfer
+    smartLEDStreamState_t _streamState;
+    uint8_t _pendingSwap;          // 1 if a committed back buffer must be picked up at the next frame boundary
+    uint32_t _streamPos;           // next LED block to be encoded in the streaming frame
+    uint32_t _streamFrameLEDs;     // streaming frame period in LED blocks, LEDs + reset gap
+    void (*_frameCallback)(struct smartLED_s* smartled); // called by the ISR at the start of each streaming frame
+    uint32_t (*_shader)(uint16_t index, uint32_t frameCounter); // pixel shader, NULL when colors are read from _txData
+    uint32_t _frameCounter;        // number of frames completed, passed to the pixel shader
+    void (*_encodeBlock)(const struct smartLED_s* smartled, uint16_t item, uint8_t* dst); // LEDperIRQ LEDs encoder of SMARTLED_DEFINE_STATIC, or NULL
+    uint16_t _fadeFrames;          // length of the crossfade from _txData to _colorsData in frames, 0 when not fading
+    uint16_t _fadeFrame;           // crossfade frames started so far
+    uint16_t _fadeBlend;           // weight of _colorsData in the frame being sent, from 0 to 256
+    uint16_t _indexOffset;         // position of the LED indices in the LED data array, after raw and scaled palette
+    uint8_t _paletteDirty;         // 1 if the palette changed since the scaled palette was built
+    uint8_t _paletteBrightness;    // brightness used to build the scaled palette
+    uint16_t _resetBlocks;         // number of 1-led-transmission-time" blocks to send logical `0` to the bus, indicating reset before data transmission starts
+#ifdef SMARTLED_USE_TIMED_RESET
+    uint32_t _latchStart;          // cycle count at which DMA was stopped, before the end of the reset
+    uint32_t _latchCycles;         // cycles the line must stay low after _latchStart before the next frame starts
+#endif /* SMARTLED_USE_TIMED_RESET */
+#ifdef SMARTLED_USE_LUT
+    uint8_t _brightnessLUT[256];   // color value scaled by _LUTBrightness
+    uint8_t _LUTBrightness;        // brightness used to build _brightnessLUT
+    uint32_t _pulseLowWord;        // _pulseLow replicated on 4 bytes
+    uint32_t _pulseXorWord;        // (_pulseLow ^ _pulseHigh) replicated on 4 bytes
+#endif /* SMARTLED_USE_LUT */
+#ifdef SMARTLED_USE_COLOR_TABLE
+    uint16_t _colorTable[256];     // output of each color value in 8.8 fixed point, gamma corrected and scaled by _colorTableBrightness
+    uint8_t _colorTableBrightness; // brightness used to build _colorTable
+#endif /* SMARTLED_USE_COLOR_TABLE */
+#ifdef SMARTLED_USE_DITHERING
+    uint8_t* _ditherError;         // fraction of each color left over by the previous frame, NULL when not dithered
+#endif /* SMARTLED_USE_DITHERING */
+#ifdef SMARTLED_USE_STATS
+    smartLEDStats_t _stats;        // statistics published at the end of each frame
+    uint32_t _statsFrameStart;     // cycle count at smartLED_startTransfer()
+    uint32_t _statsDeadline;       // cycle count by which the current refill must be complete
+    uint32_t _statsHalfCycles;     // cycles needed by the DMA to transfer half buffer
+    uint32_t _statsIRQMin, _statsIRQMax, _statsIRQSum, _statsIRQCount; // current frame accumulators
+#endif /* SMARTLED_USE_STATS */
 } smartLED_t;
 
+/**
+ * Parallel output: up to 4 strips on channels 1 to 4 of the same timer, with one DMA burst stream
+ */
+typedef struct {
+    /* Public */
+    TIM_HandleTypeDef* htim;
+    smartLED_t* lanes[SMARTLED_PARALLEL_MAX_LANES]; // lane n is sent on channel n + 1
+    uint8_t lanesNum;                               // number of lanes, from 1 to SMARTLED_PARALLEL_MAX_LANES
+    uint8_t LEDperIRQ;                              // number of LEDs to be updated per each IRQ, on every lane
+    /* Private */
+    uint8_t* _dmaBuffer;    // interleaved CCR values, lanesNum bytes per PWM period
+    uint8_t _scratch[32];   // one LED of one lane, encoded before being interleaved
+    uint8_t _updating;
+    uint32_t _cyclesCnt;
+    uint16_t _frameSize;    // number of LEDs sent by the current transfer, on the longest lane
+    uint8_t _LEDBits;       // bits to define LED color, same on every lane
+    uint16_t _resetBlocks;  // longest reset of the lanes, in LED blocks
+#ifdef SMARTLED_USE_TIMED_RESET
+    uint32_t _latchStart;   // cycle count at which DMA was stopped, before the end of the reset
+    uint32_t _latchCycles;  // cycles the lines must stay low after _latchStart before the next frame starts
+#endif /* SMARTLED_USE_TIMED_RESET */
+} smartLEDParallel_t;
+
+/**
+ * Strip group: independent strips, usually on different timers, started with phase offsets so that their refill interrupts interleave
+ */
+typedef struct {
+    /* Public */
+    smartLED_t* strips[SMARTLED_GROUP_MAX_STRIPS]; // strips of the group, started in this order
+    uint8_t stripsNum;                             // number of strips, from 1 to SMARTLED_GROUP_MAX_STRIPS
+    /* Private */
+    uint32_t _phaseCycles; // delay between the starts of two consecutive strips, in SMARTLED_GET_CYCLES() cycles
+} smartLEDGroup_t;
+
 /* Function prototypes -------------------------------------------------------*/
 
 /**
@@ -131,13 +355,77 @@ smartLED_retStatus_t smartLED_init(smartLED_t* smartled);
  * \brief           Init smart LED structure with static memory allocation
  *
  * \param[in]       smartled: pointer to smart LED object
- * \param[in]       data: pointer to LED data array of size nColors * nLEDs
- * \param[in]       BMABuffer: pointer to DMA buffer array of size 2 * LEDperIRQ * nColors * 8
+ * \param[in]       data: pointer to LED data array of size SMARTLED_DATA_SIZE(type, size, palette), nColors * nLEDs without palette and dithering
+ * \param[in]       BMABuffer: pointer to DMA buffer array of size 2 * LEDperIRQ * nColors * 8,
+ *                  (nLEDs + SMARTLED_RESET_BLOCKS(chip, type)) * nColors * 8 with SMARTLED_DMA_FULLFRAME
  *
  * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
  */
 smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, uint8_t* DMABuffer);
 
+/**
+ * \brief           Init smart LED structure with front and back buffers, with dynamic memory allocation
+ * \note            Colors are written to the back buffer and sent by smartLED_present()
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initDoubleBuffer(smartLED_t* smartled);
+
+/**
+ * \brief           Init smart LED structure with front and back buffers, with static memory allocation
+ * \note            Colors are written to the back buffer and sent by smartLED_present()
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       data: pointer to front LED data array of size SMARTLED_DATA_SIZE(type, size, palette), also holding the dithering error
+ * \param[in]       backData: pointer to back LED data array of size SMARTLED_DATA_SIZE(type, size, palette) - SMARTLED_DITHER_SIZE(type, size, palette)
+ * \param[in]       DMABuffer: pointer to DMA buffer array of size 2 * LEDperIRQ * nColors * 8,
+ *                  (nLEDs + SMARTLED_RESET_BLOCKS(chip, type)) * nColors * 8 with SMARTLED_DMA_FULLFRAME
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initStaticDoubleBuffer(smartLED_t* smartled, uint8_t* data, uint8_t* backData, uint8_t* DMABuffer);
+
+/**
+ * \brief           Init smart LED structure in pixel shader mode, with dynamic memory allocation
+ * \note            No LED data array is allocated: the color of each LED is computed by the shader when it is encoded,
+ *                  so color functions must not be used. Every transfer sends the whole strip
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       shader: function returning the color of LED index, as SMARTLED_RGB_COLOR() or SMARTLED_RGBW_COLOR(),
+ *                  during frame frameCounter. It is called from the DMA interrupt
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initShader(smartLED_t* smartled, uint32_t (*shader)(uint16_t index, uint32_t frameCounter));
+
+/**
+ * \brief           Init smart LED structure in pixel shader mode, with static memory allocation
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       shader: function returning the color of LED index during frame frameCounter
+ * \param[in]       DMABuffer: pointer to DMA buffer array of size 2 * LEDperIRQ * nColors * 8
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initShaderStatic(smartLED_t* smartled, uint32_t (*shader)(uint16_t index, uint32_t frameCounter), uint8_t* DMABuffer);
+
+/**
+ * \brief           Init smart LED structure with dynamic memory allocation, choosing LEDperIRQ from the measured encode cost
+ * \note            The smallest LEDperIRQ is chosen whose refill completes marginUs before the DMA comes back to the refilled half,
+ *                  so that the IRQ can be delayed by that long. SMARTLED_GET_CYCLES() must be running at SystemCoreClock
+ *
+ * \param[in]       smartled: pointer to smart LED object, LEDperIRQ is set by the function and left unchanged on error
+ * \param[in]       RAMBudget: maximum size of the DMA buffer, in bytes
+ * \param[in]       marginUs: time the refill must leave before its deadline, in us
+ * \param[out]      tuning: chosen LEDperIRQ and measurements, may be NULL
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly and a LEDperIRQ fits in RAMBudget,
+ *                  SMARTLED_ERROR otherwise, with no memory left allocated
+ */
+smartLED_retStatus_t smartLED_initAutoTune(smartLED_t* smartled, uint32_t RAMBudget, uint16_t marginUs, smartLEDTuning_t* tuning);
+
 /**
  * \brief           Check if smart LED is still updating
  *
@@ -151,6 +439,7 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  *
  * \param[in]       smartled: pointer to smart LED object
  * \param[in]       brightness: value of LED strip brightness, from 0 to 255
+ * \note            With SMARTLED_USE_LUT or the color table the new value is applied from the next smartLED_startTransfer()
  */
 #define smartLED_setBrightness(smartled, brightness) (smartled)->_brightness = (brightness) & 0xFF
 
@@ -168,6 +457,34 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  */
 #define smartLED_decreaseBrightness(smartled)        (smartled)->_brightness--
 
+/**
+ * \brief           Mark smart LED item as changed, so that the next transfer reaches it
+ * \note            Called by all color functions, to be used only when LED data is written by other means
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       item: LED number that was changed
+ */
+#define smartLED_markDirty(smartled, item)                                                                                                                     \
+    do {                                                                                                                                                       \
+        if ((uint16_t)(item) < (smartled)->_dirtyStart) {                                                                                                      \
+            (smartled)->_dirtyStart = (uint16_t)(item);                                                                                                        \
+        }                                                                                                                                                      \
+        if ((uint16_t)((item) + 1u) > (smartled)->_dirtyEnd) {                                                                                                 \
+            (smartled)->_dirtyEnd = (uint16_t)((item) + 1u);                                                                                                   \
+        }                                                                                                                                                      \
+    } while (0)
+
+/**
+ * \brief           Mark all smart LED items as changed, so that the next transfer sends the whole strip
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ */
+#define smartLED_invalidate(smartled)                                                                                                                          \
+    do {                                                                                                                                                       \
+        (smartled)->_dirtyStart = 0;                                                                                                                           \
+        (smartled)->_dirtyEnd = (smartled)->size;                                                                                                              \
+    } while (0)
+
 /**
  * \brief           Set RGB colors of smart LED item
  *
@@ -179,9 +496,10 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  */
 #define smartLED_updateRGBColors(smartled, item, red, green, blue)                                                                                             \
     do {                                                                                                                                                       \
-        (smartled)->_colorsData[(item) * (smartled)->type] = (red) & 0xFF;                                                                                     \
-        (smartled)->_colorsData[(item) * (smartled)->type + 1u] = (green) & 0xFF;                                                                              \
-        (smartled)->_colorsData[(item) * (smartled)->type + 2u] = (blue) & 0xFF;                                                                               \
+        (smartled)->_colorsData[(item) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_RED]] = (red) & 0xFF;                                            \
+        (smartled)->_colorsData[(item) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_GREEN]] = (green) & 0xFF;                                        \
+        (smartled)->_colorsData[(item) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_BLUE]] = (blue) & 0xFF;                                          \
+        smartLED_markDirty(smartled, item);                                                                                                                    \
     } while (0)
 
 /**
@@ -194,13 +512,14 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  * \param[in]       blue: value of blue color, from 0 to 255
  * \param[in]       white: value of white color, from 0 to 255
  */
-#define smartLED_updateRGBWColors(smartled, item, red, green, blue)                                                                                            \
+#define smartLED_updateRGBWColors(smartled, item, red, green, blue, white)                                                                                     \
     do {                                                                                                                                                       \
         if ((smartled)->type == SMARTLED_RGBW) {                                                                                                               \
-            (smartled)->_colorsData[(item) * 4u] = (red) & 0xFF;                                                                                               \
-            (smartled)->_colorsData[(item) * 4u + 1u] = (green) & 0xFF;                                                                                        \
-            (smartled)->_colorsData[(item) * 4u + 2u] = (blue) & 0xFF;                                                                                         \
-            (smartled)->_colorsData[(item) * 4u + 3u] = (white) & 0xFF;                                                                                        \
+            (smartled)->_colorsData[(item) * 4u + (smartled)->_colorOffset[SMARTLED_RED]] = (red) & 0xFF;                                                      \
+            (smartled)->_colorsData[(item) * 4u + (smartled)->_colorOffset[SMARTLED_GREEN]] = (green) & 0xFF;                                                  \
+            (smartled)->_colorsData[(item) * 4u + (smartled)->_colorOffset[SMARTLED_BLUE]] = (blue) & 0xFF;                                                    \
+            (smartled)->_colorsData[(item) * 4u + (smartled)->_colorOffset[SMARTLED_WHITE]] = (white) & 0xFF;                                                  \
+            smartLED_markDirty(smartled, item);                                                                                                                \
         }                                                                                                                                                      \
     } while (0)
 
@@ -212,7 +531,11 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  * \param[in]       color: color to be changed, SMARTLED_RED, SMARTLED_GREEN, SMARTLED_BLUE, SMARTLED_WHITE
  * \param[in]       value: value of color, from 0 to 255
  */
-#define smartLED_updateColor(smartled, item, color, value) (smartled)->_colorsData[(item) * (smartled)->type + (color)] = (value) & 0xFF
+#define smartLED_updateColor(smartled, item, color, value)                                                                                                     \
+    do {                                                                                                                                                       \
+        (smartled)->_colorsData[(item) * (smartled)->type + (smartled)->_colorOffset[color]] = (value) & 0xFF;                                                 \
+        smartLED_markDirty(smartled, item);                                                                                                                    \
+    } while (0)
 
 /**
  * \brief           Set RGB colors of all smart LED items
@@ -221,13 +544,10 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  * \param[in]       red: value of red color, from 0 to 255
  * \param[in]       green: value of green color, from 0 to 255
  * \param[in]       blue: value of blue color, from 0 to 255
+ *
+ * \return          SMARTLED_SUCCESS if colors are stored per LED, SMARTLED_ERROR otherwise
  */
-#define smartLED_updateAllRGBColors(smartled, red, green, blue)                                                                                                \
-    for (uint16_t ii = 0; ii < (smartled)->size; ii++) {                                                                                                       \
-        (smartled)->_colorsData[ii * (smartled)->type] = (red) & 0xFF;                                                                                         \
-        (smartled)->_colorsData[ii * (smartled)->type + 1u] = (green) & 0xFF;                                                                                  \
-        (smartled)->_colorsData[ii * (smartled)->type + 2u] = (blue) & 0xFF;                                                                                   \
-    }
+#define smartLED_updateAllRGBColors(smartled, red, green, blue) smartLED_fillRGBRange((smartled), 0, (smartled)->size, (red), (green), (blue))
 
 /**
  * \brief           Set RGBW colors of all smart LED items
@@ -237,26 +557,268 @@ smartLED_retStatus_t smartLED_initStatic(smartLED_t* smartled, uint8_t* data, ui
  * \param[in]       green: value of green color, from 0 to 255
  * \param[in]       blue: value of blue color, from 0 to 255
  * \param[in]       white: value of white color, from 0 to 255
+ *
+ * \return          SMARTLED_SUCCESS if colors are stored per LED on a RGBW strip, SMARTLED_ERROR otherwise
  */
 #define smartLED_updateAllRGBWColors(smartled, red, green, blue, white)                                                                                        \
-    if ((smartled)->type == SMARTLED_RGBW) {                                                                                                                   \
-        for (uint16_t ii = 0; ii < (smartled)->size; ii++) {                                                                                                   \
-            (smartled)->_colorsData[ii * 4u] = (red) & 0xFF;                                                                                                   \
-            (smartled)->_colorsData[ii * 4u + 1u] = (green) & 0xFF;                                                                                            \
-            (smartled)->_colorsData[ii * 4u + 2u] = (blue) & 0xFF;                                                                                             \
-            (smartled)->_colorsData[ii * 4u + 3u] = (white) & 0xFF;                                                                                            \
+    smartLED_fillRGBWRange((smartled), 0, (smartled)->size, (red), (green), (blue), (white))
+
+/**
+ * \brief           Set RGB colors of a range of smart LED items, leaving white unchanged on RGBW strips
+ * \note            Colors are written with word stores, 4 LEDs at a time on RGB strips
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       first: first LED to be changed
+ * \param[in]       count: number of LEDs to be changed
+ * \param[in]       red: value of red color, from 0 to 255
+ * \param[in]       green: value of green color, from 0 to 255
+ * \param[in]       blue: value of blue color, from 0 to 255
+ *
+ * \return          SMARTLED_SUCCESS if the range is within the strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_fillRGBRange(smartLED_t* smartled, uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * \brief           Set RGBW colors of a range of smart LED items
+ * \note            Colors are written with one word store per LED
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       first: first LED to be changed
+ * \param[in]       count: number of LEDs to be changed
+ * \param[in]       red: value of red color, from 0 to 255
+ * \param[in]       green: value of green color, from 0 to 255
+ * \param[in]       blue: value of blue color, from 0 to 255
+ * \param[in]       white: value of white color, from 0 to 255
+ *
+ * \return          SMARTLED_SUCCESS if the range is within a RGBW strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_fillRGBWRange(smartLED_t* smartled, uint16_t first, uint16_t count, uint8_t red, uint8_t green, uint8_t blue,
+                                            uint8_t white);
+
+/**
+ * \brief           Copy colors of a range of smart LED items from a caller buffer
+ * \note            A buffer already in the color order of the strip is copied as it is
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       first: first LED to be changed
+ * \param[in]       count: number of LEDs to be changed
+ * \param[in]       colors: nColors bytes per LED, white last, e.g. SMARTLED_ORDER_RGB for RGB(W) buffers
+ * \param[in]       order: order of red, green and blue in colors, smartled->colorOrder for wire order buffers
+ *
+ * \return          SMARTLED_SUCCESS if the range is within the strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_blit(smartLED_t* smartled, uint16_t first, uint16_t count, const uint8_t* colors, smartLEDColorOrder_t order);
+
+/**
+ * \brief           Copy a range of smart LED items to another position of the strip
+ * \note            Ranges may overlap, e.g. to scroll a segment by one LED
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       dest: first LED to be changed
+ * \param[in]       source: first LED to be copied
+ * \param[in]       count: number of LEDs to be copied
+ *
+ * \return          SMARTLED_SUCCESS if both ranges are within the strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_copyRange(smartLED_t* smartled, uint16_t dest, uint16_t source, uint16_t count);
+
+/**
+ * \brief           Rotate a range of smart LED items, LEDs shifted out of one end entering from the other one
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       first: first LED of the range
+ * \param[in]       count: number of LEDs of the range
+ * \param[in]       shift: number of positions each LED moves towards the end of the strip, negative towards its start
+ *
+ * \return          SMARTLED_SUCCESS if the range is within the strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_rotateRange(smartLED_t* smartled, uint16_t first, uint16_t count, int16_t shift);
+
+/**
+ * \brief           Convert a HSV color to RGB with integer math
+ *
+ * \param[in]       hue: hue, from 0 to 255 for a full turn starting from red
+ * \param[in]       saturation: saturation, from 0 to 255
+ * \param[in]       value: value, from 0 to 255
+ *
+ * \return          color as SMARTLED_RGB_COLOR(red, green, blue), to be returned by pixel shaders as well
+ */
+uint32_t smartLED_HSVToRGB(uint8_t hue, uint8_t saturation, uint8_t value);
+
+/**
+ * \brief           Set RGB colors of a range of smart LED items from a buffer of HSV colors, leaving white unchanged on RGBW strips
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       first: first LED to be changed
+ * \param[in]       count: number of LEDs to be changed
+ * \param[in]       HSV: hue, saturation and value of each LED, 3 bytes per LED
+ *
+ * \return          SMARTLED_SUCCESS if the range is within the strip and colors are stored per LED, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_blitHSV(smartLED_t* smartled, uint16_t first, uint16_t count, const uint8_t* HSV);
+
+/**
+ * \brief           Set RGB colors of a palette entry
+ * \note            Every LED using the entry changes, so the next transfer sends the whole strip
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       entry: palette entry to be changed, from 0 to 15 or 255
+ * \param[in]       red: value of red color, from 0 to 255
+ * \param[in]       green: value of green color, from 0 to 255
+ * \param[in]       blue: value of blue color, from 0 to 255
+ */
+#define smartLED_setPaletteRGBColors(smartled, entry, red, green, blue)                                                                                        \
+    do {                                                                                                                                                       \
+        (smartled)->_colorsData[(entry) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_RED]] = (red) & 0xFF;                                           \
+        (smartled)->_colorsData[(entry) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_GREEN]] = (green) & 0xFF;                                       \
+        (smartled)->_colorsData[(entry) * (smartled)->type + (smartled)->_colorOffset[SMARTLED_BLUE]] = (blue) & 0xFF;                                         \
+        (smartled)->_paletteDirty = 1;                                                                                                                         \
+        smartLED_invalidate(smartled);                                                                                                                         \
+    } while (0)
+
+/**
+ * \brief           Set RGBW colors of a palette entry
+ * \note            Every LED using the entry changes, so the next transfer sends the whole strip
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       entry: palette entry to be changed, from 0 to 15 or 255
+ * \param[in]       red: value of red color, from 0 to 255
+ * \param[in]       green: value of green color, from 0 to 255
+ * \param[in]       blue: value of blue color, from 0 to 255
+ * \param[in]       white: value of white color, from 0 to 255
+ */
+#define smartLED_setPaletteRGBWColors(smartled, entry, red, green, blue, white)                                                                                \
+    do {                                                                                                                                                       \
+        if ((smartled)->type == SMARTLED_RGBW) {                                                                                                               \
+            (smartled)->_colorsData[(entry) * 4u + (smartled)->_colorOffset[SMARTLED_RED]] = (red) & 0xFF;                                                     \
+            (smartled)->_colorsData[(entry) * 4u + (smartled)->_colorOffset[SMARTLED_GREEN]] = (green) & 0xFF;                                                 \
+            (smartled)->_colorsData[(entry) * 4u + (smartled)->_colorOffset[SMARTLED_BLUE]] = (blue) & 0xFF;                                                   \
+            (smartled)->_colorsData[(entry) * 4u + (smartled)->_colorOffset[SMARTLED_WHITE]] = (white) & 0xFF;                                                 \
+            (smartled)->_paletteDirty = 1;                                                                                                                     \
+            smartLED_invalidate(smartled);                                                                                                                     \
         }                                                                                                                                                      \
-    }
+    } while (0)
+
+/**
+ * \brief           Set palette index of smart LED item
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       item: LED number to be changed
+ * \param[in]       index: palette entry used by the LED, from 0 to 15 or 255
+ */
+#define smartLED_updateIndex(smartled, item, index)                                                                                                            \
+    do {                                                                                                                                                       \
+        uint8_t* _indices = &(smartled)->_colorsData[(smartled)->_indexOffset];                                                                                \
+        if ((smartled)->palette == SMARTLED_PALETTE_4BIT) {                                                                                                    \
+            uint8_t _shift = ((item) & 1u) ? 4u : 0u;                                                                                                          \
+            _indices[(item) >> 1] = (uint8_t)((_indices[(item) >> 1] & ~(0x0Fu << _shift)) | (((index) & 0x0Fu) << _shift));                                   \
+        } else {                                                                                                                                               \
+            _indices[item] = (index) & 0xFF;                                                                                                                   \
+        }                                                                                                                                                      \
+        smartLED_markDirty(smartled, item);                                                                                                                    \
+    } while (0)
+
+/**
+ * \brief           Set palette index of all smart LED items
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       index: palette entry used by the LEDs, from 0 to 15 or 255
+ */
+#define smartLED_updateAllIndexes(smartled, index)                                                                                                             \
+    do {                                                                                                                                                       \
+        if ((smartled)->palette == SMARTLED_PALETTE_4BIT) {                                                                                                    \
+            memset(&(smartled)->_colorsData[(smartled)->_indexOffset], ((index) & 0x0F) * 0x11, ((smartled)->size + 1u) >> 1);                                 \
+        } else {                                                                                                                                               \
+            memset(&(smartled)->_colorsData[(smartled)->_indexOffset], (index) & 0xFF, (smartled)->size);                                                      \
+        }                                                                                                                                                      \
+        smartLED_invalidate(smartled);                                                                                                                         \
+    } while (0)
 
 /**
  * \brief           Start data transfer to smart LED
+ * \note            Only LEDs up to the last one changed since the previous transfer are sent, the following ones keep their color.
+ *                  If nothing changed, no transfer is started. A brightness change sends the whole strip.
+ *                  With SMARTLED_DMA_FULLFRAME only the changed LEDs are encoded again, and the whole buffer is sent.
+ *                  In double buffer mode changes are those of the back buffer, sent by smartLED_present(): the whole front buffer is sent again
  *
  * \param[in]       smartled: pointer to smart LED object
  * 
- * \return          SMARTLED_SUCCESS if transfer can be initiated, SMARTLED_ERROR otherwise
+ * \return          SMARTLED_SUCCESS if transfer can be initiated, SMARTLED_ERROR otherwise,
+ *                  also while smartLED_isLatching() returns 1 with SMARTLED_USE_TIMED_RESET
  */
 smartLED_retStatus_t smartLED_startTransfer(smartLED_t* smartled);
 
+/**
+ * \brief           Swap front and back buffers and start data transfer to smart LED
+ * \note            The new back buffer is a copy of the frame being sent, so it can be updated incrementally while the transfer runs.
+ *                  Without back buffer, it is the same as smartLED_startTransfer().
+ *                  While streaming, the frame is committed and swapped by the ISR at the next frame boundary, and the new back buffer
+ *                  holds the previous frame
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          SMARTLED_SUCCESS if transfer can be initiated, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_present(smartLED_t* smartled);
+
+/**
+ * \brief           Start continuous transfer to smart LED at a fixed refresh rate
+ * \note            DMA and timer keep running, the reset gap between two frames is sent as empty LED blocks. At the start of each frame
+ *                  the ISR picks up the buffer committed by smartLED_present() (double buffer mode) and calls frameCallback.
+ *                  Without back buffer, colors are read live from the LED data array. Not available with SMARTLED_DMA_FULLFRAME
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       refreshRate: frames per second, 0 for the highest rate allowed by the strip size
+ * \param[in]       frameCallback: function called from the ISR at the start of each frame, can be NULL
+ *
+ * \return          SMARTLED_SUCCESS if streaming can be started at the requested rate, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_startStreaming(smartLED_t* smartled, uint16_t refreshRate, void (*frameCallback)(smartLED_t* smartled));
+
+/**
+ * \brief           Stop continuous transfer to smart LED after the current frame
+ * \note            smartLED_isUpdating() returns 0 once DMA is stopped
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          SMARTLED_SUCCESS if streaming was running, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_stopStreaming(smartLED_t* smartled);
+
+/**
+ * \brief           Check if a frame committed by smartLED_present() while streaming is still waiting to be picked up
+ * \note            The back buffer must not be written until the frame is picked up
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          1 if frame is pending, 0 otherwise
+ */
+#define smartLED_isPresentPending(smartled) (smartled)->_pendingSwap
+
+/**
+ * \brief           Crossfade from the front buffer to the back buffer, interpolating each LED while it is encoded
+ * \note            Requires double buffer mode, without palette and pixel shader. While streaming, the fade starts at the next frame
+ *                  boundary and advances by one step per frame; otherwise each smartLED_startTransfer() sends the next step. At the last
+ *                  frame the buffers are swapped and, as after smartLED_present(), the back buffer is a copy of the new front one, so it can
+ *                  be updated incrementally; while streaming it holds the starting frame instead, every frame being sent whole.
+ *                  The back buffer must not be written and smartLED_present() fails until the fade is complete
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       frames: fade length in frames, the last one sending the back buffer as it is
+ *
+ * \return          SMARTLED_SUCCESS if the fade is started, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_crossfade(smartLED_t* smartled, uint16_t frames);
+
+/**
+ * \brief           Check if a crossfade is running
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          1 if the back buffer is still being faded in, 0 otherwise
+ */
+#define smartLED_isFading(smartled) ((smartled)->_fadeFrames != 0)
+
 /**
  * \brief           Wait until data transfer to smart LED is successfully completed
  *
@@ -298,8 +860,253 @@ smartLED_retStatus_t smartLED_startTransfer(smartLED_t* smartled);
  */
 smartLED_retStatus_t smartLED_updateTransfer(smartLED_t* smartled, smartLEDIRQType_t PWM_IRQ);
 
+/**
+ * \brief           Init parallel output with dynamic memory allocation
+ * \note            chip, type and size of each lane must be set, while htim, timChannel and LEDperIRQ of the lanes
+ *                  are set from the parallel object. All lanes must have the same type
+ *
+ * \param[in]       parallel: pointer to parallel output object
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initParallel(smartLEDParallel_t* parallel);
+
+/**
+ * \brief           Init parallel output with static memory allocation
+ *
+ * \param[in]       parallel: pointer to parallel output object
+ * \param[in]       data: array of lanesNum pointers to LED data arrays of size SMARTLED_DATA_SIZE(type, size, palette) of each lane,
+ *                  raw and scaled palette and dithering error included, nColors * nLEDs without palette and dithering
+ * \param[in]       DMABuffer: pointer to DMA buffer array of size 2 * LEDperIRQ * nColors * 8 * lanesNum
+ *
+ * \return          SMARTLED_SUCCESS if parameters are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initParallelStatic(smartLEDParallel_t* parallel, uint8_t* const data[], uint8_t* DMABuffer);
+
+/**
+ * \brief           Start data transfer on all lanes
+ * \note            Each lane sends up to its last changed LED, shorter lanes are padded with zero-duty periods
+ *
+ * \param[in]       parallel: pointer to parallel output object
+ *
+ * \return          SMARTLED_SUCCESS if transfer is started or nothing changed, SMARTLED_ERROR if a transfer or, with SMARTLED_USE_TIMED_RESET,
+ *                  the reset after it is ongoing
+ */
+smartLED_retStatus_t smartLED_startParallelTransfer(smartLEDParallel_t* parallel);
+
+/**
+ * \brief           Check if parallel output is still updating
+ *
+ * \param[in]       parallel: pointer to parallel output object
+ *
+ * \return          1 if parallel output is updating, 0 otherwise
+ */
+#define smartLED_isParallelUpdating(parallel) (parallel)->_updating
+
+/**
+ * \brief           Update interleaved DMA buffer of all lanes
+ * \attention       Function to be called by HAL_TIM_PeriodElapsedHalfCpltCallback() and HAL_TIM_PeriodElapsedCallback()
+ *
+ * \param[in]       parallel: pointer to parallel output object
+ * \param[in]       PWM_IRQ: type of interrupt that is calling the function, either SMARTLED_IRQ_HALFCPLT or SMARTLED_IRQ_FINISHED
+ *
+ * \return          SMARTLED_SUCCESS if data can be updated succesfully, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_updateParallelTransfer(smartLEDParallel_t* parallel, smartLEDIRQType_t PWM_IRQ);
+
+/**
+ * \brief           Init strip group, once all its strips are initialized
+ * \note            Strips are started half buffer / stripsNum apart, the half buffer being the shortest among the circular DMA strips.
+ *                  SMARTLED_GET_CYCLES() must be running at SystemCoreClock
+ *
+ * \param[in]       group: pointer to strip group object
+ *
+ * \return          SMARTLED_SUCCESS if strips are configured correctly, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initGroup(smartLEDGroup_t* group);
+
+/**
+ * \brief           Start the transfer of all strips of the group, with their phase offsets
+ * \note            Busy waits with SMARTLED_GET_CYCLES() between two consecutive starts, with interrupts enabled
+ *
+ * \param[in]       group: pointer to strip group object
+ *
+ * \return          SMARTLED_SUCCESS if all strips started, SMARTLED_ERROR if a strip is still updating (none is started) or failed to start
+ */
+smartLED_retStatus_t smartLED_startGroupTransfer(smartLEDGroup_t* group);
+
+/**
+ * \brief           Present all strips of the group with smartLED_present(), with their phase offsets
+ *
+ * \param[in]       group: pointer to strip group object
+ *
+ * \return          SMARTLED_SUCCESS if all strips were presented, SMARTLED_ERROR if a strip is still updating (none is presented) or failed to present
+ */
+smartLED_retStatus_t smartLED_presentGroup(smartLEDGroup_t* group);
+
+/**
+ * \brief           Check if any strip of the group is still updating
+ *
+ * \param[in]       group: pointer to strip group object
+ *
+ * \return          1 until every strip of the group completed its transfer, 0 otherwise
+ */
+uint8_t smartLED_isGroupUpdating(const smartLEDGroup_t* group);
+
+#ifdef SMARTLED_USE_STATS
+/**
+ * \brief           Get transfer statistics
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[out]      stats: pointer to statistics struct to be filled
+ *
+ * \return          SMARTLED_SUCCESS
+ */
+smartLED_retStatus_t smartLED_getStats(const smartLED_t* smartled, smartLEDStats_t* stats);
+
+/**
+ * \brief           Reset transfer statistics
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          SMARTLED_SUCCESS
+ */
+smartLED_retStatus_t smartLED_resetStats(smartLED_t* smartled);
+#endif /* SMARTLED_USE_STATS */
+
+#ifdef SMARTLED_USE_TIMED_RESET
+/**
+ * \brief           Check if the reset after the last transfer is still running
+ * \note            DMA is stopped once an empty LED block follows the data, and smartLED_isUpdating() returns 0 from then on.
+ *                  Until the rest of the reset has elapsed, starting a transfer on the strip, on its group or on its parallel output fails
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ *
+ * \return          1 if the line must stay low before the next frame, 0 otherwise
+ */
+uint8_t smartLED_isLatching(smartLED_t* smartled);
+#endif /* SMARTLED_USE_TIMED_RESET */
+
+/* Static definition ---------------------------------------------------------*/
+
+/**
+ * \brief           Encode LEDperIRQ LEDs of plain colors with type and LEDperIRQ known at compile time, used by SMARTLED_DEFINE_STATIC
+ * \note            Both loops are fully unrolled up to 32 LEDs per IRQ, larger blocks are unrolled by 32 to bound code size
+ *
+ * \param[in]       smartled: pointer to smart LED object
+ * \param[in]       item: index of the first LED
+ * \param[out]      dst: pointer to the DMA half buffer
+ * \param[in]       type: LED type, a constant
+ * \param[in]       LEDperIRQ: number of LEDs, a constant
+ */
+static inline void smartLED_encodeBlock(const smartLED_t* smartled, uint16_t item, uint8_t* dst, const uint8_t type, const uint8_t LEDperIRQ) {
+    const uint8_t* color = &smartled->_txData[(uint32_t)item * type];
+    const uint32_t lowWord = smartled->_pulseLow * 0x01010101u;
+    const uint32_t xorWord = (uint8_t)(smartled->_pulseLow ^ smartled->_pulseHigh) * 0x01010101u;
+
+    SMARTLED_UNROLL
+    for (uint32_t led = 0; led < LEDperIRQ; led++) {
+        SMARTLED_UNROLL
+        for (uint32_t ii = 0; ii < type; ii++) {
+#if defined(SMARTLED_USE_COLOR_TABLE)
+            uint32_t value = (smartled->_colorTable[color[ii]] + 0x80u) >> 8;
+#elif defined(SMARTLED_USE_LUT)
+            uint32_t value = smartled->_brightnessLUT[color[ii]];
+#else
+            uint32_t value = ((uint32_t)color[ii] * smartled->_brightness) / 0xFFu;
+#endif /* SMARTLED_USE_COLOR_TABLE */
+            /* Spread each nibble MSB first over the 4 bytes of a little-endian word, 0xFF for a `1` bit, and select the pulses 4 slots per store */
+            uint32_t w0 = lowWord ^ (xorWord & (((((value >> 4) * 0x08040201u) >> 3) & 0x01010101u) * 0xFFu));
+            uint32_t w1 = lowWord ^ (xorWord & (((((value & 0x0Fu) * 0x08040201u) >> 3) & 0x01010101u) * 0xFFu));
+
+            memcpy(dst, &w0, sizeof(uint32_t));
+            memcpy(dst + 4, &w1, sizeof(uint32_t));
+            dst += 8;
+        }
+        color += type;
+    }
+}
+
+/**
+ * \brief           Define a strip with static buffers sized at compile time and an encoder specialized for its constants
+ *
+ * Used once at file scope and followed by a semicolon, it defines `smartLED_t name` with chip, type, size and LEDperIRQ set,
+ * its LED data array, its circular DMA buffer, and `name##_init()` to be called in place of smartLED_initStatic() once the other public fields are set.
+ * The specialized encoder refills the circular buffer when colors are sent as they are stored,
+ * the generic one handles pixel shaders, crossfades, dithering and SPI output. Available in C11, see smartLEDStatic for C++
+ *
+ * \param[in]       name: name of the smart LED object
+ * \param[in]       ledChip: WS2811 or WS2812B
+ * \param[in]       ledType: SMARTLED_RGB or SMARTLED_RGBW
+ * \param[in]       ledSize: number of LEDs
+ * \param[in]       ledsPerIRQ: number of LEDs to be updated per each PWM IRQ
+ */
+#define SMARTLED_DEFINE_STATIC(name, ledChip, ledType, ledSize, ledsPerIRQ)                                                                                    \
+    _Static_assert(((ledType) == SMARTLED_RGB) || ((ledType) == SMARTLED_RGBW), #name ": type must be SMARTLED_RGB or SMARTLED_RGBW");                         \
+    _Static_assert(((ledSize) >= 1) && ((ledSize) <= 0xFFFF), #name ": size must be from 1 to 65535");                                                         \
+    _Static_assert(((ledsPerIRQ) >= 1) && ((ledsPerIRQ) <= 0xFF), #name ": LEDperIRQ must be from 1 to 255");                                                  \
+    static _Alignas(uint32_t) uint8_t name##_data[SMARTLED_DATA_SIZE(ledType, ledSize, SMARTLED_PALETTE_NONE)];                                                \
+    static _Alignas(uint32_t) uint8_t name##_DMABuffer[SMARTLED_DMA_SIZE(ledType, ledsPerIRQ)];                                                                \
+    extern smartLED_t name;                                                                                                                                    \
+    static void name##_encodeBlock(const smartLED_t* smartled, uint16_t item, uint8_t* dst) {                                                                  \
+        smartLED_encodeBlock(smartled, item, dst, (ledType), (ledsPerIRQ));                                                                                    \
+    }                                                                                                                                                          \
+    static smartLED_retStatus_t name##_init(void) {                                                                                                            \
+        if ((name.type != (ledType)) || (name.size != (ledSize)) || (name.LEDperIRQ != (ledsPerIRQ)) || (name.dmaMode != SMARTLED_DMA_CIRCULAR)                \
+            || (name.palette != SMARTLED_PALETTE_NONE) || (smartLED_initStatic(&name, name##_data, name##_DMABuffer) != SMARTLED_SUCCESS)) {                   \
+            return SMARTLED_ERROR;                                                                                                                             \
+        }                                                                                                                                                      \
+        name._encodeBlock = name##_encodeBlock;                                                                                                                \
+        return SMARTLED_SUCCESS;                                                                                                                               \
+    }                                                                                                                                                          \
+    smartLED_t name = {.chip = (ledChip), .type = (ledType), .size = (ledSize), .LEDperIRQ = (ledsPerIRQ)}
+
 #ifdef __cplusplus
 }
-#endif
+
+/**
+ * Strip with static buffers sized at compile time and an encoder specialized for its constants, C++ equivalent of SMARTLED_DEFINE_STATIC.
+ * Set the other public fields of `strip`, then call init()
+ */
+template <smartLEDChip_t Chip, smartLEDType_t Type, uint16_t Size, uint8_t LEDperIRQ>
+class smartLEDStatic {
+  public:
+    static constexpr uint32_t dataSize = SMARTLED_DATA_SIZE(Type, Size, SMARTLED_PALETTE_NONE);
+    static constexpr uint32_t DMASize = SMARTLED_DMA_SIZE(Type, LEDperIRQ);
+
+    static_assert((Type == SMARTLED_RGB) || (Type == SMARTLED_RGBW), "type must be SMARTLED_RGB or SMARTLED_RGBW");
+    static_assert(Size >= 1, "size must be from 1 to 65535");
+    static_assert(LEDperIRQ >= 1, "LEDperIRQ must be from 1 to 255");
+
+    smartLED_t strip;
+
+    smartLEDStatic() : strip(), _data(), _DMABuffer() {
+        strip.chip = Chip;
+        strip.type = Type;
+        strip.size = Size;
+        strip.LEDperIRQ = LEDperIRQ;
+    }
+
+    /**
+     * \brief           Init the strip on the static buffers, in place of smartLED_initStatic()
+     *
+     * \return          SMARTLED_SUCCESS if parameters still match the template arguments and are configured correctly, SMARTLED_ERROR otherwise
+     */
+    smartLED_retStatus_t init() {
+        if ((strip.type != Type) || (strip.size != Size) || (strip.LEDperIRQ != LEDperIRQ) || (strip.dmaMode != SMARTLED_DMA_CIRCULAR)
+            || (strip.palette != SMARTLED_PALETTE_NONE) || (smartLED_initStatic(&strip, _data, _DMABuffer) != SMARTLED_SUCCESS)) {
+            return SMARTLED_ERROR;
+        }
+        strip._encodeBlock = encodeBlock;
+        return SMARTLED_SUCCESS;
+    }
+
+  private:
+    alignas(uint32_t) uint8_t _data[dataSize];
+    alignas(uint32_t) uint8_t _DMABuffer[DMASize];
+
+    static void encodeBlock(const smartLED_t* smartled, uint16_t item, uint8_t* dst) { smartLED_encodeBlock(smartled, item, dst, Type, LEDperIRQ); }
+};
+#endif /* __cplusplus */
 
 #endif /* __SMARTLED_H__ */
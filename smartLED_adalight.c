@@ -0,0 +1,182 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            smartLED_adalight.c
+ * \author          Andrea Vivani
+ * \brief           Adalight serial protocol ingest for smart LED strips
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Includes ------------------------------------------------------------------*/
+
+#include "smartLED_adalight.h"
+
+/* Macros --------------------------------------------------------------------*/
+
+/* XOR of the two LED count bytes with this value is the header checksum */
+#define SMARTLED_ADALIGHT_CHECKSUM_KEY 0x55u
+
+/* Private Functions ---------------------------------------------------------*/
+
+/* LED data array is not read by the ISR, or is read live by design while streaming without back buffer. A full frame is encoded
+ * before its transfer starts */
+static uint8_t smartLED_adalightCanWrite(const smartLED_t* smartled) {
+    if (smartled->_pendingSwap || smartled->_fadeFrames) {
+        return 0;
+    }
+    return (smartled->_txData != smartled->_colorsData) || !smartled->_updating || (smartled->_streamState != SMARTLED_STREAM_OFF)
+           || (smartled->dmaMode == SMARTLED_DMA_FULLFRAME);
+}
+
+/* Store color bytes of the current frame in wire order, return number of bytes consumed */
+static uint32_t smartLED_adalightData(smartLEDAdalight_t* ada, const uint8_t* data, uint32_t length) {
+    smartLED_t* smartled = ada->smartled;
+    const uint8_t* offset = smartled->_colorOffset;
+    uint32_t stored = (ada->_LEDs < smartled->size) ? ada->_LEDs : smartled->size;
+    uint32_t pos = 0;
+
+    while ((pos < length) && (ada->_LED < ada->_LEDs)) {
+        if (ada->_LED >= stored) {
+            /* LEDs beyond the strip are dropped */
+            uint32_t skip = (ada->_LEDs - ada->_LED) * 3u - ada->_color;
+            if (skip > (length - pos)) {
+                skip = length - pos;
+            }
+            pos += skip;
+            skip += ada->_color;
+            ada->_LED += skip / 3u;
+            ada->_color = skip % 3u;
+        } else if ((ada->_color == 0) && ((length - pos) >= 3u)) {
+            /* Whole LEDs */
+            uint32_t LEDs = (length - pos) / 3u;
+            uint8_t* dst = &smartled->_colorsData[ada->_LED * smartled->type];
+            if (LEDs > (stored - ada->_LED)) {
+                LEDs = stored - ada->_LED;
+            }
+            ada->_LED += LEDs;
+            for (; LEDs; LEDs--) {
+                dst[offset[SMARTLED_RED]] = data[pos];
+                dst[offset[SMARTLED_GREEN]] = data[pos + 1u];
+                dst[offset[SMARTLED_BLUE]] = data[pos + 2u];
+                dst += smartled->type;
+                pos += 3u;
+            }
+        } else {
+            /* LED split across chunks */
+            smartled->_colorsData[ada->_LED * smartled->type + offset[ada->_color]] = data[pos++];
+            if (++ada->_color == 3u) {
+                ada->_color = 0;
+                ada->_LED++;
+            }
+        }
+    }
+    return pos;
+}
+
+/* Functions -----------------------------------------------------------------*/
+
+smartLED_retStatus_t smartLED_initAdalight(smartLEDAdalight_t* ada, smartLED_t* smartled) {
+    if ((smartled->_colorsData == NULL) || (smartled->palette != SMARTLED_PALETTE_NONE) || (smartled->_shader != NULL)) {
+        return SMARTLED_ERROR;
+    }
+    ada->smartled = smartled;
+    ada->_state = SMARTLED_ADALIGHT_MAGIC_A;
+    ada->_countHi = 0;
+    ada->_countLo = 0;
+    ada->_color = 0;
+    ada->_LED = 0;
+    ada->_LEDs = 0;
+    ada->_frames = 0;
+    ada->_checksumErrors = 0;
+    return SMARTLED_SUCCESS;
+}
+
+uint32_t smartLED_parseAdalight(smartLEDAdalight_t* ada, const uint8_t* data, uint32_t length) {
+    smartLED_t* smartled = ada->smartled;
+    uint32_t pos = 0;
+
+    /* A completed frame is presented even if it ends the chunk */
+    while ((pos < length) || (ada->_state == SMARTLED_ADALIGHT_PRESENT)) {
+        uint8_t byte = (pos < length) ? data[pos] : 0;
+
+        switch (ada->_state) {
+            case SMARTLED_ADALIGHT_MAGIC_A:
+                ada->_state = (byte == 'A') ? SMARTLED_ADALIGHT_MAGIC_D : SMARTLED_ADALIGHT_MAGIC_A;
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_MAGIC_D:
+                ada->_state = (byte == 'd') ? SMARTLED_ADALIGHT_MAGIC_A2 : ((byte == 'A') ? SMARTLED_ADALIGHT_MAGIC_D : SMARTLED_ADALIGHT_MAGIC_A);
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_MAGIC_A2:
+                ada->_state = (byte == 'a') ? SMARTLED_ADALIGHT_COUNT_HI : ((byte == 'A') ? SMARTLED_ADALIGHT_MAGIC_D : SMARTLED_ADALIGHT_MAGIC_A);
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_COUNT_HI:
+                ada->_countHi = byte;
+                ada->_state = SMARTLED_ADALIGHT_COUNT_LO;
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_COUNT_LO:
+                ada->_countLo = byte;
+                ada->_state = SMARTLED_ADALIGHT_CHECKSUM;
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_CHECKSUM:
+                if (byte != (ada->_countHi ^ ada->_countLo ^ SMARTLED_ADALIGHT_CHECKSUM_KEY)) {
+                    ada->_checksumErrors++;
+                    ada->_state = SMARTLED_ADALIGHT_MAGIC_A;
+                } else {
+                    ada->_LEDs = (((uint32_t)ada->_countHi << 8) | ada->_countLo) + 1u;
+                    ada->_LED = 0;
+                    ada->_color = 0;
+                    ada->_state = SMARTLED_ADALIGHT_DATA;
+                }
+                pos++;
+                break;
+            case SMARTLED_ADALIGHT_DATA:
+                if (!smartLED_adalightCanWrite(smartled)) {
+                    return pos;
+                }
+                pos += smartLED_adalightData(ada, &data[pos], length - pos);
+                if (ada->_LED == ada->_LEDs) {
+                    smartLED_markDirty(smartled, 0);
+                    smartLED_markDirty(smartled, ((ada->_LEDs < smartled->size) ? ada->_LEDs : smartled->size) - 1u);
+                    ada->_state = SMARTLED_ADALIGHT_PRESENT;
+                }
+                break;
+            case SMARTLED_ADALIGHT_PRESENT:
+                if (smartLED_present(smartled) != SMARTLED_SUCCESS) {
+                    return pos;
+                }
+                ada->_frames++;
+                ada->_state = SMARTLED_ADALIGHT_MAGIC_A;
+                break;
+        }
+    }
+    return pos;
+}
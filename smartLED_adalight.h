@@ -0,0 +1,137 @@
+/* BEGIN Header */
+/**
+ ******************************************************************************
+ * \file            smartLED_adalight.h
+ * \author          Andrea Vivani
+ * \brief           Adalight serial protocol ingest for smart LED strips
+ ******************************************************************************
+ * \copyright
+ *
+ * Copyright 2024 Andrea Vivani
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ */
+/* END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SMARTLED_ADALIGHT_H__
+#define __SMARTLED_ADALIGHT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Includes ------------------------------------------------------------------*/
+
+#include "smartLED.h"
+
+/* Typedefs ------------------------------------------------------------------*/
+
+/**
+ * Adalight parser state
+ */
+typedef enum {
+    SMARTLED_ADALIGHT_MAGIC_A = 0,
+    SMARTLED_ADALIGHT_MAGIC_D = 1,
+    SMARTLED_ADALIGHT_MAGIC_A2 = 2,
+    SMARTLED_ADALIGHT_COUNT_HI = 3,
+    SMARTLED_ADALIGHT_COUNT_LO = 4,
+    SMARTLED_ADALIGHT_CHECKSUM = 5,
+    SMARTLED_ADALIGHT_DATA = 6,
+    SMARTLED_ADALIGHT_PRESENT = 7,
+} smartLEDAdalightState_t;
+
+/**
+ * Adalight parser struct
+ */
+typedef struct {
+    /* Public */
+    smartLED_t* smartled;            // strip receiving the frames
+    /* Private */
+    smartLEDAdalightState_t _state;
+    uint8_t _countHi, _countLo;      // LED count of the frame header, minus one
+    uint8_t _color;                  // next color of the current LED, in Adalight order (red, green, blue)
+    uint32_t _LED;                   // LED the next color byte belongs to
+    uint32_t _LEDs;                  // number of LEDs in the current frame
+    uint32_t _frames;                // number of frames received and presented
+    uint32_t _checksumErrors;        // number of headers discarded for a wrong checksum
+} smartLEDAdalight_t;
+
+/* Function prototypes -------------------------------------------------------*/
+
+/**
+ * \brief           Initialize Adalight parser
+ * \note            The strip must be initialized before, with colors stored per LED and without pixel shader
+ *
+ * \param[in]       ada: pointer to Adalight parser object
+ * \param[in]       smartled: pointer to smart LED object receiving the frames
+ *
+ * \return          SMARTLED_SUCCESS if parser can be used with the strip, SMARTLED_ERROR otherwise
+ */
+smartLED_retStatus_t smartLED_initAdalight(smartLEDAdalight_t* ada, smartLED_t* smartled);
+
+/**
+ * \brief           Parse a chunk of an Adalight byte stream, writing colors straight into the LED data array
+ * \note            Frames are "Ada", LED count - 1 (MSB first), checksum (count MSB ^ count LSB ^ 0x55), then RGB triplets. Chunks can be
+ *                  split anywhere, headers with a wrong checksum are discarded and the parser looks for the next one. LEDs beyond the strip
+ *                  size are dropped, the white color of RGBW LEDs is not changed. At the end of each frame smartLED_present() is called.
+ *                  Parsing stops without consuming the rest of the chunk while the colors cannot be written: until the previous frame
+ *                  is presented, while a single buffer is being sent in circular mode (not streaming) or while a frame committed by
+ *                  smartLED_present() is pending. The remaining bytes must then be passed again, a length of 0 only retries the pending
+ *                  smartLED_present()
+ *
+ * \param[in]       ada: pointer to Adalight parser object
+ * \param[in]       data: pointer to received bytes, e.g. the filled part of a DMA RX ring buffer
+ * \param[in]       length: number of received bytes
+ *
+ * \return          number of bytes consumed
+ */
+uint32_t smartLED_parseAdalight(smartLEDAdalight_t* ada, const uint8_t* data, uint32_t length);
+
+/**
+ * \brief           Reset Adalight parser, the next frame starts from a header
+ *
+ * \param[in]       ada: pointer to Adalight parser object
+ */
+#define smartLED_resetAdalight(ada)          ((ada)->_state = SMARTLED_ADALIGHT_MAGIC_A)
+
+/**
+ * \brief           Get number of Adalight frames received and presented
+ *
+ * \param[in]       ada: pointer to Adalight parser object
+ *
+ * \return          number of frames
+ */
+#define smartLED_getAdalightFrames(ada)      (ada)->_frames
+
+/**
+ * \brief           Get number of Adalight headers discarded for a wrong checksum
+ *
+ * \param[in]       ada: pointer to Adalight parser object
+ *
+ * \return          number of discarded headers
+ */
+#define smartLED_getAdalightErrors(ada)      (ada)->_checksumErrors
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SMARTLED_ADALIGHT_H__ */